@@ -24,9 +24,8 @@
 class CustomCommandProcessor : public NordicUARTService
 {
 public:
-    // Do not get confused by this method's name.
     // Data is received here.
-    void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    void onReceive(const uint8_t *incomingData, size_t size) override;
 
 private:
     // Methods that execute received commands
@@ -84,10 +83,10 @@ char *split(char *string)
  * @brief Parse incoming data
  *
  */
-void CustomCommandProcessor::onWrite(NimBLECharacteristic *pCharacteristic)
+void CustomCommandProcessor::onReceive(const uint8_t *incomingData, size_t size)
 {
-    // convert data to a null-terminated string
-    const char *data = pCharacteristic->getValue().c_str();
+    // incoming data is a null-terminated string
+    const char *data = (const char *)incomingData;
     Serial.printf("--Incoming text line:\n%s\n", data);
 
     // Preliminary check to discard wrong commands early
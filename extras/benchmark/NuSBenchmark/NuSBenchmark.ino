@@ -0,0 +1,308 @@
+/**
+ * @file NuSBenchmark.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Throughput and latency benchmark of the Nordic UART Service
+ *
+ * @note Use along with extras/benchmark/nus_benchmark.py.
+ *       See extras/benchmark/README.md for a description.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <NimBLEDevice.h>
+#include "NuPacket.hpp"
+#include "NuSerial.hpp"
+
+//------------------------------------------------------
+// Globals
+//------------------------------------------------------
+
+#define DEVICE_NAME "NuS benchmark"
+#define BENCHMARK_VERSION 1
+
+// Reception modes
+#define MODE_PACKET 0
+#define MODE_SERIAL 1
+#define MODE_READBYTES 2
+
+// Size of the NuSerial.readBytes() block in MODE_READBYTES
+#define READBYTES_BLOCK_SIZE 256
+
+// Benchmark states
+#define STATE_COMMAND 0
+#define STATE_RX 1
+#define STATE_ECHO 2
+
+const char *modeNames[] = {"packet", "serial", "readbytes"};
+
+Preferences preferences;
+NordicUARTService *nus;
+int mode = MODE_PACKET;
+uint16_t preferredMTU = BLE_ATT_MTU_MAX;
+
+int state = STATE_COMMAND;
+size_t expectedBytes = 0;
+size_t processedBytes = 0;
+size_t readCount = 0;
+int64_t startTime = 0;
+
+char commandLine[64];
+size_t commandLength = 0;
+uint8_t rxBuffer[NUS_MAX_FRAME_SIZE];
+uint8_t txBuffer[NUS_MAX_FRAME_SIZE];
+
+//------------------------------------------------------
+// Auxiliary
+//------------------------------------------------------
+
+void reply(const char *format, ...)
+{
+    char buffer[160];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+    va_end(args);
+    if (length > (int)(sizeof(buffer) - 2))
+        length = sizeof(buffer) - 2;
+    if (length < 0)
+        return;
+    buffer[length++] = '\n';
+    nus->write((const uint8_t *)buffer, length);
+    buffer[length] = '\0';
+    Serial.print(buffer);
+}
+
+void restartIn(uint32_t millis)
+{
+    delay(millis);
+    ESP.restart();
+}
+
+//------------------------------------------------------
+// Benchmark commands
+//------------------------------------------------------
+
+void txTest(size_t totalBytes, size_t writeSize)
+{
+    if ((writeSize == 0) || (writeSize > sizeof(txBuffer)))
+        writeSize = sizeof(txBuffer);
+    for (size_t i = 0; i < writeSize; i++)
+        txBuffer[i] = i & 0xFF;
+
+    size_t sent = 0;
+    size_t writeCount = 0;
+    size_t deliveredBefore = nus->getTxDeliveredCount();
+    int64_t start = esp_timer_get_time();
+    while ((sent < totalBytes) && nus->isConnected())
+    {
+        size_t count = totalBytes - sent;
+        if (count > writeSize)
+            count = writeSize;
+        size_t written = nus->write(txBuffer, count);
+        if (written == 0)
+            break;
+        sent += written;
+        writeCount++;
+    }
+    nus->flush();
+    int64_t elapsed = esp_timer_get_time() - start;
+    reply("{\"test\":\"tx\",\"mode\":\"%s\",\"mtu\":%u,\"bytes\":%u,\"delivered\":%u,\"writes\":%u,\"us\":%lld}",
+          modeNames[mode],
+          nus->getMTU(),
+          sent,
+          nus->getTxDeliveredCount() - deliveredBefore,
+          writeCount,
+          elapsed);
+}
+
+void executeCommand(char *command)
+{
+    unsigned int a = 0, b = 0;
+    char name[16];
+    Serial.printf("--Command: %s\n", command);
+    if (sscanf(command, "!RX %u", &a) == 1)
+    {
+        // Reply when all bytes have been received
+        state = STATE_RX;
+        expectedBytes = a;
+        processedBytes = 0;
+        readCount = 0;
+        startTime = 0;
+    }
+    else if (sscanf(command, "!ECHO %u", &a) == 1)
+    {
+        // Echo the following bytes
+        state = STATE_ECHO;
+        expectedBytes = a;
+        processedBytes = 0;
+    }
+    else if (sscanf(command, "!TX %u %u", &a, &b) == 2)
+        txTest(a, b);
+    else if (strcmp(command, "!INFO") == 0)
+        reply("{\"version\":%d,\"mode\":\"%s\",\"mtu\":%u,\"preferred_mtu\":%u,\"max_frame\":%u}",
+              BENCHMARK_VERSION,
+              modeNames[mode],
+              nus->getMTU(),
+              preferredMTU,
+              NUS_MAX_FRAME_SIZE);
+    else if (sscanf(command, "!MODE %15s", name) == 1)
+    {
+        for (int m = MODE_PACKET; m <= MODE_READBYTES; m++)
+            if (strcmp(name, modeNames[m]) == 0)
+            {
+                preferences.putInt("mode", m);
+                reply("{\"restart\":true,\"mode\":\"%s\"}", name);
+                restartIn(500);
+            }
+        reply("{\"error\":\"unknown mode\"}");
+    }
+    else if (sscanf(command, "!MTU %u", &a) == 1)
+    {
+        // Note: takes effect after reconnection
+        preferences.putUShort("mtu", a);
+        reply("{\"restart\":true,\"preferred_mtu\":%u}", a);
+        restartIn(500);
+    }
+    else
+        reply("{\"error\":\"unknown command\"}");
+}
+
+//------------------------------------------------------
+// Incoming data processing
+//------------------------------------------------------
+
+void consume(const uint8_t *data, size_t size)
+{
+    readCount++;
+    while (size > 0)
+    {
+        if (state == STATE_COMMAND)
+        {
+            char c = *data++;
+            size--;
+            if ((c == '\n') || (c == '\r'))
+            {
+                commandLine[commandLength] = '\0';
+                if (commandLength > 0)
+                    executeCommand(commandLine);
+                commandLength = 0;
+            }
+            else if (commandLength < (sizeof(commandLine) - 1))
+                commandLine[commandLength++] = c;
+        }
+        else
+        {
+            size_t count = expectedBytes - processedBytes;
+            if (count > size)
+                count = size;
+            if (state == STATE_ECHO)
+                nus->write(data, count);
+            else if (startTime == 0)
+                startTime = esp_timer_get_time();
+            data += count;
+            size -= count;
+            processedBytes += count;
+            if (processedBytes >= expectedBytes)
+            {
+                if (state == STATE_RX)
+                    reply("{\"test\":\"rx\",\"mode\":\"%s\",\"mtu\":%u,\"bytes\":%u,\"reads\":%u,\"us\":%lld}",
+                          modeNames[mode],
+                          nus->getMTU(),
+                          processedBytes,
+                          readCount,
+                          esp_timer_get_time() - startTime);
+                state = STATE_COMMAND;
+            }
+        }
+    }
+}
+
+void resetState()
+{
+    state = STATE_COMMAND;
+    commandLength = 0;
+}
+
+//------------------------------------------------------
+// Arduino entry points
+//------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("***********************************");
+    Serial.println(" Nordic UART Service benchmark     ");
+    Serial.println("***********************************");
+    Serial.println("--Initializing--");
+
+    // Load settings
+    preferences.begin("nusbench", false);
+    mode = preferences.getInt("mode", MODE_PACKET);
+    if ((mode < MODE_PACKET) || (mode > MODE_READBYTES))
+        mode = MODE_PACKET;
+    preferredMTU = preferences.getUShort("mtu", BLE_ATT_MTU_MAX);
+    Serial.printf("--Mode: %s. Preferred MTU: %u\n", modeNames[mode], preferredMTU);
+
+    // Initialize BLE stack and Nordic UART service
+    NimBLEDevice::init(DEVICE_NAME);
+    NimBLEDevice::setMTU(preferredMTU);
+    if (mode == MODE_PACKET)
+        nus = &NuPacket;
+    else
+    {
+        nus = &NuSerial;
+        NuSerial.setTimeout(20);
+    }
+    // Note: the host chooses between writes with or without response
+    nus->start(true);
+
+    // Initialization complete
+    Serial.println("--Ready--");
+}
+
+void loop()
+{
+    if (!nus->isConnected())
+    {
+        Serial.println("--Waiting for connection--");
+        nus->connect();
+        resetState();
+        Serial.println("--Connected--");
+    }
+
+    size_t size = 0;
+    switch (mode)
+    {
+    case MODE_PACKET:
+    {
+        const uint8_t *data = NuPacket.read(size);
+        if (data)
+            consume(data, size);
+        break;
+    }
+    case MODE_SERIAL:
+    {
+        int available = NuSerial.available();
+        if (available > 0)
+        {
+            size = (available > (int)sizeof(rxBuffer)) ? sizeof(rxBuffer) : available;
+            size = NuSerial.readBytes(rxBuffer, size);
+            consume(rxBuffer, size);
+        }
+        else
+            // Non-blocking semantics
+            delay(1);
+        break;
+    }
+    default:
+        size = NuSerial.readBytes(rxBuffer, READBYTES_BLOCK_SIZE);
+        if (size > 0)
+            consume(rxBuffer, size);
+        break;
+    }
+}
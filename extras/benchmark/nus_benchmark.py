@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""
+Host-side client of the NuSBenchmark sketch.
+
+Runs throughput and latency tests against a device running
+extras/benchmark/NuSBenchmark and prints every result as a JSON
+object, one per line, so results can be stored and compared
+between library versions.
+
+Requires Python 3.8+ and bleak (pip install bleak).
+
+Author: Ángel Fernández Pineda. Madrid. Spain.
+Date: 2026-10-14
+License: Creative Commons Attribution 4.0 International (CC BY 4.0)
+"""
+
+import argparse
+import asyncio
+import json
+import statistics
+import sys
+import time
+
+from bleak import BleakClient, BleakScanner
+
+RX_CHARACTERISTIC_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+TX_CHARACTERISTIC_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+MODES = ["packet", "serial", "readbytes"]
+RESTART_DELAY = 4.0
+
+
+class Benchmark:
+    """Connection to a NuSBenchmark device"""
+
+    def __init__(self, args):
+        self.args = args
+        self.client = None
+        self.incoming = bytearray()
+        self.data_event = asyncio.Event()
+
+    # ------------------------------------------------------------------
+    # Connection
+    # ------------------------------------------------------------------
+
+    async def connect(self):
+        if self.args.address:
+            device = self.args.address
+        else:
+            device = await BleakScanner.find_device_by_name(
+                self.args.name, timeout=self.args.timeout
+            )
+            if device is None:
+                raise RuntimeError(f"Device '{self.args.name}' not found")
+        self.client = BleakClient(device)
+        await self.client.connect()
+        self.incoming.clear()
+        await self.client.start_notify(TX_CHARACTERISTIC_UUID, self.on_notify)
+
+    async def disconnect(self):
+        if self.client and self.client.is_connected:
+            await self.client.disconnect()
+        self.client = None
+
+    async def reconnect(self):
+        await self.disconnect()
+        await asyncio.sleep(RESTART_DELAY)
+        await self.connect()
+
+    def on_notify(self, _sender, data):
+        self.incoming.extend(data)
+        self.data_event.set()
+
+    @property
+    def frame_size(self):
+        # Note: ATT_MTU-3, as the firmware does
+        return max(20, min(self.client.mtu_size - 3, 512))
+
+    # ------------------------------------------------------------------
+    # Data exchange
+    # ------------------------------------------------------------------
+
+    async def send(self, data):
+        for index in range(0, len(data), self.frame_size):
+            await self.client.write_gatt_char(
+                RX_CHARACTERISTIC_UUID,
+                data[index : index + self.frame_size],
+                response=not self.args.no_response,
+            )
+
+    async def read_exact(self, count):
+        deadline = time.monotonic() + self.args.timeout
+        while len(self.incoming) < count:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                raise TimeoutError(f"{len(self.incoming)} of {count} bytes received")
+            self.data_event.clear()
+            try:
+                await asyncio.wait_for(self.data_event.wait(), remaining)
+            except asyncio.TimeoutError:
+                pass
+        data = bytes(self.incoming[:count])
+        del self.incoming[:count]
+        return data
+
+    async def read_reply(self):
+        deadline = time.monotonic() + self.args.timeout
+        while b"\n" not in self.incoming:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                raise TimeoutError("No reply")
+            self.data_event.clear()
+            try:
+                await asyncio.wait_for(self.data_event.wait(), remaining)
+            except asyncio.TimeoutError:
+                pass
+        index = self.incoming.index(b"\n")
+        line = bytes(self.incoming[:index])
+        del self.incoming[: index + 1]
+        return json.loads(line.decode())
+
+    async def command(self, text, reply=True):
+        await self.send((text + "\n").encode())
+        if reply:
+            return await self.read_reply()
+        return None
+
+    # ------------------------------------------------------------------
+    # Tests
+    # ------------------------------------------------------------------
+
+    async def info(self):
+        return await self.command("!INFO")
+
+    async def rx_test(self, total, write_size):
+        """Host to device throughput"""
+        await self.command(f"!RX {total}", reply=False)
+        payload = bytes(i & 0xFF for i in range(write_size))
+        start = time.perf_counter()
+        sent = 0
+        while sent < total:
+            chunk = payload[: min(write_size, total - sent)]
+            await self.send(chunk)
+            sent += len(chunk)
+        result = await self.read_reply()
+        elapsed = time.perf_counter() - start
+        result["write_size"] = write_size
+        result["host_s"] = round(elapsed, 6)
+        result["bytes_per_s"] = round(result["bytes"] * 1e6 / max(result["us"], 1), 1)
+        result["reads_per_s"] = round(result["reads"] * 1e6 / max(result["us"], 1), 1)
+        return result
+
+    async def tx_test(self, total, write_size):
+        """Device to host throughput"""
+        self.incoming.clear()
+        start = time.perf_counter()
+        await self.command(f"!TX {total} {write_size}", reply=False)
+        data = await self.read_exact(total)
+        elapsed = time.perf_counter() - start
+        result = await self.read_reply()
+        errors = sum(1 for i, b in enumerate(data) if b != ((i % write_size) & 0xFF))
+        result["write_size"] = write_size
+        result["host_s"] = round(elapsed, 6)
+        result["bytes_per_s"] = round(total / elapsed, 1)
+        result["pattern_errors"] = errors
+        return result
+
+    async def echo_test(self, count, size):
+        """Round-trip latency"""
+        await self.command(f"!ECHO {count * size}", reply=False)
+        payload = bytes((i * 7) & 0xFF for i in range(size))
+        latencies = []
+        for _ in range(count):
+            start = time.perf_counter()
+            await self.send(payload)
+            echoed = await self.read_exact(size)
+            latencies.append((time.perf_counter() - start) * 1000.0)
+            if echoed != payload:
+                raise RuntimeError("Echoed data does not match")
+        latencies.sort()
+        info = await self.info()
+
+        def percentile(p):
+            return round(latencies[min(len(latencies) - 1, int(p * len(latencies)))], 3)
+
+        return {
+            "test": "echo",
+            "mode": info["mode"],
+            "mtu": info["mtu"],
+            "size": size,
+            "count": count,
+            "ms_min": round(latencies[0], 3),
+            "ms_p50": percentile(0.50),
+            "ms_p90": percentile(0.90),
+            "ms_p99": percentile(0.99),
+            "ms_max": round(latencies[-1], 3),
+            "ms_mean": round(statistics.mean(latencies), 3),
+        }
+
+    # ------------------------------------------------------------------
+    # Sweeps
+    # ------------------------------------------------------------------
+
+    async def set_mode(self, mode):
+        info = await self.info()
+        if info["mode"] != mode:
+            await self.command(f"!MODE {mode}")
+            await self.reconnect()
+
+    async def set_mtu(self, mtu):
+        info = await self.info()
+        if info["preferred_mtu"] != mtu:
+            await self.command(f"!MTU {mtu}")
+            await self.reconnect()
+
+    async def run(self):
+        await self.connect()
+        try:
+            for mtu in self.args.mtu or [None]:
+                if mtu:
+                    await self.set_mtu(mtu)
+                for mode in self.args.mode:
+                    await self.set_mode(mode)
+                    emit(await self.info())
+                    for size in self.args.write_size:
+                        if "rx" in self.args.test:
+                            emit(await self.rx_test(self.args.bytes, size))
+                        if "tx" in self.args.test:
+                            emit(await self.tx_test(self.args.bytes, size))
+                        if "echo" in self.args.test:
+                            emit(await self.echo_test(self.args.echo_count, size))
+        finally:
+            await self.disconnect()
+
+
+def emit(result):
+    result["timestamp"] = round(time.time(), 3)
+    print(json.dumps(result), flush=True)
+
+
+def integer_list(text):
+    return [int(item) for item in text.split(",") if item]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Nordic UART Service benchmark client")
+    parser.add_argument("--name", default="NuS benchmark", help="advertised device name")
+    parser.add_argument("--address", help="device address (skips scanning)")
+    parser.add_argument(
+        "--test",
+        type=lambda text: text.split(","),
+        default=["rx", "tx", "echo"],
+        help="comma-separated list of tests: rx, tx, echo",
+    )
+    parser.add_argument(
+        "--mode",
+        type=lambda text: text.split(","),
+        default=["packet"],
+        help="comma-separated list of reception modes: " + ", ".join(MODES),
+    )
+    parser.add_argument(
+        "--write-size",
+        type=integer_list,
+        default=[20, 128, 244],
+        help="comma-separated list of write sizes in bytes",
+    )
+    parser.add_argument("--mtu", type=integer_list, help="comma-separated list of preferred MTUs")
+    parser.add_argument(
+        "--no-response", action="store_true", help="use writes without response"
+    )
+    parser.add_argument("--bytes", type=int, default=65536, help="bytes per throughput test")
+    parser.add_argument("--echo-count", type=int, default=100, help="round trips per echo test")
+    parser.add_argument("--timeout", type=float, default=30.0, help="timeout in seconds")
+    args = parser.parse_args()
+
+    for mode in args.mode:
+        if mode not in MODES:
+            parser.error(f"unknown mode '{mode}'")
+
+    try:
+        asyncio.run(Benchmark(args).run())
+    except (RuntimeError, TimeoutError) as error:
+        print(json.dumps({"error": str(error)}), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
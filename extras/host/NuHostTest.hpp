@@ -0,0 +1,44 @@
+/**
+ * @file NuHostTest.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Minimal assertion utilities for host-side tests
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_HOST_TEST_HPP__
+#define __NU_HOST_TEST_HPP__
+
+#include <cstdio>
+
+static int testFailures = 0;
+static int testCount = 0;
+
+/**
+ * @brief Check a condition, report failures and go on
+ *
+ */
+#define NU_CHECK(condition)                                                        \
+    do                                                                             \
+    {                                                                              \
+        testCount++;                                                               \
+        if (!(condition))                                                          \
+        {                                                                          \
+            testFailures++;                                                        \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                          \
+    } while (0)
+
+/**
+ * @brief Print a summary and get the exit code of the test program
+ *
+ */
+static int testSummary(const char *name)
+{
+    std::printf("%s: %d checks, %d failures\n", name, testCount, testFailures);
+    return (testFailures == 0) ? 0 : 1;
+}
+
+#endif
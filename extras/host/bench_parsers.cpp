@@ -0,0 +1,208 @@
+/**
+ * @file bench_parsers.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Microbenchmarks of the AT and shell command parsers
+ *
+ * @note Measures parse and dispatch time per command line
+ *       for representative workloads: `bench_parsers [iterations]`.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "NuATCommandParser.hpp"
+#include "NuCLIParser.hpp"
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+#define COMMAND_COUNT 64
+
+static volatile size_t sink = 0;
+static std::vector<std::string> commandNames;
+
+//-----------------------------------------------------------------------------
+// AT command parser
+//-----------------------------------------------------------------------------
+
+class NuATCommandBench : public NuATCommandParser, NuATCommandCallbacks
+{
+public:
+    virtual void printATResponse(const char message[]) override
+    {
+        sink = sink + message[0];
+    };
+
+    virtual int getATCommandId(const char commandName[]) override
+    {
+        // Note: linear search, as most applications do
+        for (size_t i = 0; i < commandNames.size(); i++)
+            if (strcmp(commandNames[i].c_str(), commandName) == 0)
+                return (int)i;
+        return -1;
+    };
+
+    virtual NuATCommandResult_t onExecute(int commandId) override
+    {
+        sink = sink + commandId;
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onSet(int commandId, NuATCommandParameters_t &parameters) override
+    {
+        sink = sink + parameters.size();
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onQuery(int commandId) override
+    {
+        printATResponse("1");
+        return AT_RESULT_OK;
+    };
+
+    NuATCommandBench()
+    {
+        setATCallbacks(this);
+    };
+
+    using NuATCommandParser::parseCommandData;
+    using NuATCommandParser::parseCommandLine;
+};
+
+//-----------------------------------------------------------------------------
+// Measurement
+//-----------------------------------------------------------------------------
+
+template <typename F>
+static void measure(const char *name, const std::vector<std::string> &lines, long iterations, F parse)
+{
+    // Warm up
+    for (const std::string &line : lines)
+        parse(line);
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+        parse(lines[i % lines.size()]);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    printf("%-40s %10.1f ns/line\n", name, ns / iterations);
+}
+
+//-----------------------------------------------------------------------------
+// Workloads
+//-----------------------------------------------------------------------------
+
+static std::string longText(size_t length)
+{
+    std::string result;
+    while (result.size() < length)
+        result.append("lorem ipsum ");
+    result.resize(length);
+    return result;
+}
+
+static void benchAT(long iterations)
+{
+    NuATCommandBench parser;
+    parser.setBufferSize(256);
+    std::vector<std::string> lines;
+
+    // Many different commands
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+        lines.push_back("AT+" + commandNames[i] + ((i % 2) ? "=1,2,3" : "?"));
+    measure("AT: many commands", lines, iterations, [&parser](const std::string &line)
+            { parser.parseCommandLine(line.c_str()); });
+
+    // Long quoted parameters
+    lines.clear();
+    lines.push_back("AT+" + commandNames[0] + "=\"" + longText(200) + "\"");
+    lines.push_back("AT+" + commandNames[1] + "=\"" + longText(100) + "\",\"" + longText(100) + "\"");
+    measure("AT: long quoted parameters", lines, iterations, [&parser](const std::string &line)
+            { parser.parseCommandLine(line.c_str()); });
+
+    // Many ;-separated commands
+    lines.clear();
+    std::string line = "AT";
+    for (size_t i = 0; i < 16; i++)
+        line.append((i ? ";+" : "+") + commandNames[i * 4] + ((i % 2) ? "=7" : ""));
+    lines.push_back(line);
+    measure("AT: 16 commands per line", lines, iterations, [&parser](const std::string &line)
+            { parser.parseCommandLine(line.c_str()); });
+
+    // Line assembly of the previous workload
+    parser.lineAssembly(true);
+    lines[0].append("\n");
+    measure("AT: 16 commands, line assembly", lines, iterations, [&parser](const std::string &line)
+            { parser.parseCommandData((const uint8_t *)line.data(), line.size()); });
+}
+
+static void benchShell(long iterations)
+{
+    NuCLIParser classic;
+    NuCLIParser view;
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+    {
+        classic.on(commandNames[i], [](NuCommandLine_t &commandLine)
+                   { sink = sink + commandLine.size(); });
+        view.on(commandNames[i], [](NuCommandLineView_t &commandLine)
+                { sink = sink + commandLine.size(); });
+    }
+    std::vector<std::string> lines;
+
+    // Many different commands
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+        lines.push_back(commandNames[i] + " arg1 arg2 42");
+    measure("Shell: many commands", lines, iterations, [&classic](const std::string &line)
+            { classic.execute((const uint8_t *)line.data(), line.size()); });
+    measure("Shell (views): many commands", lines, iterations, [&view](const std::string &line)
+            { view.execute((const uint8_t *)line.data(), line.size()); });
+
+    // Long quoted parameters
+    lines.clear();
+    lines.push_back(commandNames[0] + " \"" + longText(200) + "\"");
+    lines.push_back(commandNames[1] + " \"" + longText(90) + "\"\"quoted\"\"" + longText(90) + "\"");
+    measure("Shell: long quoted parameters", lines, iterations, [&classic](const std::string &line)
+            { classic.execute((const uint8_t *)line.data(), line.size()); });
+    measure("Shell (views): long quoted parameters", lines, iterations, [&view](const std::string &line)
+            { view.execute((const uint8_t *)line.data(), line.size()); });
+
+    // Many lines per chunk
+    lines.clear();
+    std::string chunk;
+    for (size_t i = 0; i < 8; i++)
+        chunk.append(commandNames[i * 8] + " arg1 42\n");
+    lines.push_back(chunk);
+    view.lineAssembly(true);
+    measure("Shell (views): 8 lines, line assembly", lines, iterations, [&view](const std::string &line)
+            { view.executeData((const uint8_t *)line.data(), line.size()); });
+}
+
+//-----------------------------------------------------------------------------
+// Entry point
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    long iterations = (argc > 1) ? strtol(argv[1], nullptr, 10) : 200000;
+    if (iterations <= 0)
+        iterations = 1;
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+    {
+        // Note: AT command names are alphabetic
+        std::string name = "CMD";
+        name.push_back('A' + (i / 26));
+        name.push_back('A' + (i % 26));
+        commandNames.push_back(name);
+    }
+    benchAT(iterations);
+    benchShell(iterations);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file fuzz_driver.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Standalone driver for the fuzzing entry point
+ *
+ * @note Used when libFuzzer is not available.
+ *       With file arguments, each file is run as a single input.
+ *       Otherwise, pseudo-random inputs biased towards the parsers'
+ *       syntax are generated: `fuzz_driver [runs] [seed]`.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static const char alphabet[] = "ATat+&=?;,\"\\ \r\nPZclassicview0123456789";
+
+static uint32_t nextRandom(uint32_t &state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+int main(int argc, char *argv[])
+{
+    long runs = 100000;
+    uint32_t seed = 0x4E755321;
+    if ((argc > 1) && (argv[1][0] >= '0') && (argv[1][0] <= '9'))
+    {
+        runs = strtol(argv[1], nullptr, 10);
+        if (argc > 2)
+            seed = (uint32_t)strtoul(argv[2], nullptr, 10) | 1;
+    }
+    else if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+        printf("fuzz_driver: %d inputs\n", argc - 1);
+        return 0;
+    }
+
+    std::vector<uint8_t> input;
+    for (long run = 0; run < runs; run++)
+    {
+        input.clear();
+        size_t size = nextRandom(seed) % 300;
+        bool preamble = (nextRandom(seed) % 4) != 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            uint32_t r = nextRandom(seed);
+            if ((i == 1) && preamble)
+            {
+                input.push_back('A');
+                input.push_back('T');
+            }
+            else if (r % 8 == 0)
+                input.push_back((uint8_t)(r >> 8));
+            else
+                input.push_back(alphabet[(r >> 8) % (sizeof(alphabet) - 1)]);
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("fuzz_driver: %ld runs\n", runs);
+    return 0;
+}
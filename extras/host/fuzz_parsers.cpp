@@ -0,0 +1,169 @@
+/**
+ * @file fuzz_parsers.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Fuzzing entry point for the AT and shell command parsers
+ *
+ * @note libFuzzer compatible. The first byte of the input selects the target:
+ *       - 0: AT parser, single command line.
+ *       - 1: AT parser, line assembly (input split in chunks).
+ *       - 2: Shell parser, single command line.
+ *       - 3: Shell parser, line assembly (input split in chunks).
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "NuATCommandParser.hpp"
+#include "NuCLIParser.hpp"
+
+//-----------------------------------------------------------------------------
+// MOCK
+//-----------------------------------------------------------------------------
+
+class NuATCommandFuzzer : public NuATCommandParser, NuATCommandCallbacks
+{
+public:
+    size_t outputSize = 0;
+
+public:
+    virtual void printATResponse(const char message[]) override
+    {
+        if (!holdATResponse(message))
+            outputSize += strlen(message);
+    };
+
+    virtual int getATCommandId(const char commandName[]) override
+    {
+        // Note: some commands are not supported
+        return (commandName[0] == 'Z') ? -1 : (unsigned char)commandName[0];
+    };
+
+    virtual NuATCommandResult_t onExecute(int commandId) override
+    {
+        if (commandId == 'P')
+        {
+            // Complete later
+            NuATCompletionToken_t token = beginAsync();
+            if (token)
+                pending = token;
+            return AT_RESULT_PENDING;
+        }
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onSet(int commandId, NuATCommandParameters_t &parameters) override
+    {
+        for (const char *param : parameters)
+            outputSize += strlen(param);
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onQuery(int commandId) override
+    {
+        printATResponse("value");
+        return AT_RESULT_OK;
+    };
+
+    void run(const uint8_t *data, size_t size, bool assembly)
+    {
+        if (assembly)
+        {
+            lineAssembly(true, 64);
+            // Note: chunk sizes are taken from the input itself
+            size_t index = 0;
+            while (index < size)
+            {
+                size_t chunk = 1 + (data[index] % 20);
+                if (chunk > size - index)
+                    chunk = size - index;
+                parseCommandData(data + index, chunk);
+                index += chunk;
+            }
+        }
+        else
+        {
+            std::string commandLine((const char *)data, size);
+            parseCommandLine(commandLine.c_str());
+        }
+        if (pending)
+            complete(pending, AT_RESULT_OK, "late");
+        pending = 0;
+        discardPendingResponses();
+    };
+
+    NuATCommandFuzzer()
+    {
+        setATCallbacks(this);
+    };
+
+private:
+    NuATCompletionToken_t pending = 0;
+};
+
+static void fuzzShell(const uint8_t *data, size_t size, bool assembly)
+{
+    static NuCLIParser parser;
+    static size_t count = 0;
+    static bool initialized = false;
+    if (!initialized)
+    {
+        parser.lineAssembly(true, 64);
+        parser
+            .on("classic", [](NuCommandLine_t &commandLine)
+                { count += commandLine.size(); })
+            .on("view", [](NuCommandLineView_t &commandLine)
+                {
+                    for (std::string_view item : commandLine)
+                        count += item.size(); })
+            .onUnknown([](NuCommandLine_t &commandLine)
+                       { count += commandLine[0].size(); });
+        initialized = true;
+    }
+    if (assembly)
+    {
+        // Note: chunk sizes are taken from the input itself
+        size_t index = 0;
+        while (index < size)
+        {
+            size_t chunk = 1 + (data[index] % 20);
+            if (chunk > size - index)
+                chunk = size - index;
+            parser.executeData(data + index, chunk);
+            index += chunk;
+        }
+    }
+    else
+        parser.execute(data, size);
+}
+
+//-----------------------------------------------------------------------------
+// Entry point
+//-----------------------------------------------------------------------------
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size == 0)
+        return 0;
+    static NuATCommandFuzzer atFuzzer;
+    switch (data[0] % 4)
+    {
+    case 0:
+        atFuzzer.run(data + 1, size - 1, false);
+        break;
+    case 1:
+        atFuzzer.run(data + 1, size - 1, true);
+        break;
+    case 2:
+        fuzzShell(data + 1, size - 1, false);
+        break;
+    default:
+        fuzzShell(data + 1, size - 1, true);
+        break;
+    }
+    return 0;
+}
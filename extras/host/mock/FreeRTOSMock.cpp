@@ -0,0 +1,470 @@
+/**
+ * @file FreeRTOSMock.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS (the subset used by this library)
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+#include "freertos/message_buffer.h"
+#include "esp_timer.h"
+
+//-----------------------------------------------------------------------------
+// Time
+//-----------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+// Note: function-local statics, since global objects of other
+// translation units may use FreeRTOS in their constructors
+
+static Clock::time_point getStartTime()
+{
+    static const Clock::time_point startTime = Clock::now();
+    return startTime;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - getStartTime()).count();
+}
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - getStartTime()).count();
+}
+
+// Wait on a condition variable for a number of ticks (portMAX_DELAY is forever)
+template <typename Predicate>
+static bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+//-----------------------------------------------------------------------------
+// Semaphores
+//-----------------------------------------------------------------------------
+
+struct MockSemaphore
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    // Recursive mutexes only
+    bool recursive = false;
+    std::thread::id owner;
+    UBaseType_t depth = 0;
+};
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    MockSemaphore *semaphore = new MockSemaphore();
+    semaphore->maxCount = maxCount;
+    semaphore->count = initialCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    return createSemaphore(maxCount, initialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount, StaticSemaphore_t *buffer)
+{
+    return createSemaphore(maxCount, initialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *buffer)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)createSemaphore(1, 1);
+    semaphore->recursive = true;
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)handle;
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!waitFor(semaphore->cv, lock, ticks, [semaphore]
+                 { return semaphore->count > 0; }))
+        return pdFALSE;
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)handle;
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount)
+        return pdFALSE;
+    semaphore->count++;
+    semaphore->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t handle, TickType_t ticks)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)handle;
+    std::thread::id self = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if ((semaphore->depth > 0) && (semaphore->owner == self))
+    {
+        semaphore->depth++;
+        return pdTRUE;
+    }
+    if (!waitFor(semaphore->cv, lock, ticks, [semaphore]
+                 { return semaphore->depth == 0; }))
+        return pdFALSE;
+    semaphore->owner = self;
+    semaphore->depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t handle)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)handle;
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if ((semaphore->depth == 0) || (semaphore->owner != std::this_thread::get_id()))
+        return pdFALSE;
+    if (--semaphore->depth == 0)
+        semaphore->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t handle)
+{
+    MockSemaphore *semaphore = (MockSemaphore *)handle;
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle)
+{
+    delete (MockSemaphore *)handle;
+}
+
+//-----------------------------------------------------------------------------
+// Tasks
+//-----------------------------------------------------------------------------
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char *name,
+    uint32_t stackSize,
+    void *parameter,
+    UBaseType_t priority,
+    TaskHandle_t *handle,
+    BaseType_t coreID)
+{
+    std::thread(function, parameter).detach();
+    if (handle)
+        *handle = nullptr;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    // Note: a distinct value per thread
+    static thread_local char self;
+    return &self;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+//-----------------------------------------------------------------------------
+// Timers
+//-----------------------------------------------------------------------------
+
+struct MockTimer
+{
+    TickType_t period;
+    bool autoReload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool active = false;
+    TickType_t expiry = 0;
+};
+
+static std::mutex timersMutex;
+
+static std::vector<MockTimer *> &getTimers()
+{
+    static std::vector<MockTimer *> timers;
+    return timers;
+}
+
+TimerHandle_t xTimerCreateStatic(
+    const char *name,
+    TickType_t period,
+    UBaseType_t autoReload,
+    void *id,
+    TimerCallbackFunction_t callback,
+    StaticTimer_t *buffer)
+{
+    MockTimer *timer = new MockTimer();
+    timer->period = period;
+    timer->autoReload = autoReload;
+    timer->id = id;
+    timer->callback = callback;
+    std::lock_guard<std::mutex> lock(timersMutex);
+    getTimers().push_back(timer);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t handle, TickType_t ticks)
+{
+    MockTimer *timer = (MockTimer *)handle;
+    std::lock_guard<std::mutex> lock(timersMutex);
+    timer->active = true;
+    timer->expiry = xTaskGetTickCount() + timer->period;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t handle, TickType_t ticks)
+{
+    MockTimer *timer = (MockTimer *)handle;
+    std::lock_guard<std::mutex> lock(timersMutex);
+    timer->active = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t handle, TickType_t period, TickType_t ticks)
+{
+    // Note: as in FreeRTOS, the timer is started, too
+    MockTimer *timer = (MockTimer *)handle;
+    std::lock_guard<std::mutex> lock(timersMutex);
+    timer->period = period;
+    timer->active = true;
+    timer->expiry = xTaskGetTickCount() + period;
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t handle)
+{
+    MockTimer *timer = (MockTimer *)handle;
+    std::lock_guard<std::mutex> lock(timersMutex);
+    return timer->active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t handle)
+{
+    return ((MockTimer *)handle)->id;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t handle, TickType_t ticks)
+{
+    std::lock_guard<std::mutex> lock(timersMutex);
+    std::vector<MockTimer *> &timers = getTimers();
+    for (size_t i = 0; i < timers.size(); i++)
+        if (timers[i] == handle)
+        {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    delete (MockTimer *)handle;
+    return pdPASS;
+}
+
+size_t mockRunTimers()
+{
+    size_t count = 0;
+    for (;;)
+    {
+        // Note: callbacks are called with no lock held, since they may use timers
+        MockTimer *expired = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(timersMutex);
+            TickType_t now = xTaskGetTickCount();
+            for (MockTimer *timer : getTimers())
+                if (timer->active && ((int32_t)(now - timer->expiry) >= 0))
+                {
+                    expired = timer;
+                    if (timer->autoReload)
+                        timer->expiry = now + timer->period;
+                    else
+                        timer->active = false;
+                    break;
+                }
+        }
+        if (!expired)
+            return count;
+        expired->callback(expired);
+        count++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Event groups
+//-----------------------------------------------------------------------------
+
+struct MockEventGroup
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer)
+{
+    return new MockEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t handle, EventBits_t bits)
+{
+    MockEventGroup *group = (MockEventGroup *)handle;
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t handle, EventBits_t bits)
+{
+    MockEventGroup *group = (MockEventGroup *)handle;
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t result = group->bits;
+    group->bits &= ~bits;
+    return result;
+}
+
+EventBits_t xEventGroupWaitBits(
+    EventGroupHandle_t handle,
+    EventBits_t bits,
+    BaseType_t clearOnExit,
+    BaseType_t waitForAll,
+    TickType_t ticks)
+{
+    MockEventGroup *group = (MockEventGroup *)handle;
+    std::unique_lock<std::mutex> lock(group->mutex);
+    bool ready = waitFor(group->cv, lock, ticks, [group, bits, waitForAll]
+                         { return waitForAll ? ((group->bits & bits) == bits) : ((group->bits & bits) != 0); });
+    EventBits_t result = group->bits;
+    if (ready && clearOnExit)
+        group->bits &= ~bits;
+    return result;
+}
+
+void vEventGroupDelete(EventGroupHandle_t handle)
+{
+    delete (MockEventGroup *)handle;
+}
+
+//-----------------------------------------------------------------------------
+// Message buffers
+//-----------------------------------------------------------------------------
+
+struct MockMessageBuffer
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> messages;
+    size_t capacity;
+    size_t used = 0;
+};
+
+MessageBufferHandle_t xMessageBufferCreate(size_t size)
+{
+    MockMessageBuffer *buffer = new MockMessageBuffer();
+    buffer->capacity = size;
+    return buffer;
+}
+
+size_t xMessageBufferSend(MessageBufferHandle_t handle, const void *data, size_t size, TickType_t ticks)
+{
+    MockMessageBuffer *buffer = (MockMessageBuffer *)handle;
+    size_t required = size + sizeof(size_t);
+    std::unique_lock<std::mutex> lock(buffer->mutex);
+    if (required > buffer->capacity)
+        return 0;
+    if (!waitFor(buffer->cv, lock, ticks, [buffer, required]
+                 { return buffer->capacity - buffer->used >= required; }))
+        return 0;
+    buffer->messages.emplace_back((const uint8_t *)data, (const uint8_t *)data + size);
+    buffer->used += required;
+    buffer->cv.notify_all();
+    return size;
+}
+
+size_t xMessageBufferReceive(MessageBufferHandle_t handle, void *data, size_t size, TickType_t ticks)
+{
+    MockMessageBuffer *buffer = (MockMessageBuffer *)handle;
+    std::unique_lock<std::mutex> lock(buffer->mutex);
+    if (!waitFor(buffer->cv, lock, ticks, [buffer]
+                 { return !buffer->messages.empty(); }))
+        return 0;
+    std::vector<uint8_t> &message = buffer->messages.front();
+    if (message.size() > size)
+        // As in FreeRTOS, the message is kept
+        return 0;
+    size_t count = message.size();
+    memcpy(data, message.data(), count);
+    buffer->used -= count + sizeof(size_t);
+    buffer->messages.pop_front();
+    buffer->cv.notify_all();
+    return count;
+}
+
+size_t xMessageBufferSpacesAvailable(MessageBufferHandle_t handle)
+{
+    MockMessageBuffer *buffer = (MockMessageBuffer *)handle;
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    return buffer->capacity - buffer->used;
+}
+
+BaseType_t xMessageBufferReset(MessageBufferHandle_t handle)
+{
+    MockMessageBuffer *buffer = (MockMessageBuffer *)handle;
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->messages.clear();
+    buffer->used = 0;
+    buffer->cv.notify_all();
+    return pdPASS;
+}
+
+void vMessageBufferDelete(MessageBufferHandle_t handle)
+{
+    delete (MockMessageBuffer *)handle;
+}
@@ -0,0 +1,11 @@
+/**
+ * @file NimBLECharacteristic.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of NimBLE-Arduino. See NimBLEDevice.h.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NimBLEDevice.h"
@@ -0,0 +1,375 @@
+/**
+ * @file NimBLEDevice.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of NimBLE-Arduino 1.4 (the subset used by this library)
+ *
+ * @note There is no radio. Tests play the role of the peer and the BLE stack
+ *       through the NimBLEMock namespace: connections, subscriptions, writes
+ *       and notification completions are simulated there.
+ *
+ * @note As in NimBLE-Arduino, characteristic events are dispatched
+ *       only to the callbacks set on that characteristic.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_NIMBLE_DEVICE_H__
+#define __MOCK_NIMBLE_DEVICE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+//-----------------------------------------------------------------------------
+// Host stack
+//-----------------------------------------------------------------------------
+
+#define BLE_HS_EAGAIN 1
+#define BLE_HS_EINVAL 3
+#define BLE_HS_ENOMEM 6
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_EBUSY 15
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_ATT_MTU_DFLT 23
+#define BLE_ATT_MTU_MAX 527
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+#define BLE_GAP_LE_PHY_ANY_MASK 0x0F
+#define BLE_GAP_LE_PHY_CODED_ANY 0
+
+struct os_mbuf;
+
+struct ble_gap_conn_desc
+{
+    uint16_t conn_handle;
+    uint16_t conn_itvl;
+    uint16_t conn_latency;
+    uint16_t supervision_timeout;
+};
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om);
+int ble_gap_set_prefered_le_phy(uint16_t conn_handle, uint8_t tx_phys_mask, uint8_t rx_phys_mask, uint16_t phy_opts);
+int ble_gattc_exchange_mtu(uint16_t conn_handle, void *cb, void *cb_arg);
+
+//-----------------------------------------------------------------------------
+// NimBLE-Arduino
+//-----------------------------------------------------------------------------
+
+namespace NIMBLE_PROPERTY
+{
+    enum
+    {
+        READ = 0x0002,
+        WRITE_NR = 0x0004,
+        WRITE = 0x0008,
+        NOTIFY = 0x0010,
+        INDICATE = 0x0020
+    };
+}
+
+class NimBLECharacteristic;
+class NimBLEServer;
+
+class NimBLEAttValue
+{
+public:
+    NimBLEAttValue() {};
+    NimBLEAttValue(const uint8_t *data, size_t size) : value(data, data + size) {};
+
+    const uint8_t *data() const
+    {
+        // Note: null-terminated, as in NimBLE
+        terminated = value;
+        terminated.push_back(0);
+        return terminated.data();
+    };
+
+    uint16_t size() const
+    {
+        return (uint16_t)value.size();
+    };
+
+    uint16_t length() const
+    {
+        return size();
+    };
+
+private:
+    std::vector<uint8_t> value;
+    mutable std::vector<uint8_t> terminated;
+};
+
+class NimBLECharacteristicCallbacks
+{
+public:
+    typedef enum
+    {
+        SUCCESS_INDICATE,
+        SUCCESS_NOTIFY,
+        ERROR_INDICATE_DISABLED,
+        ERROR_NOTIFY_DISABLED,
+        ERROR_GATT,
+        ERROR_NO_CLIENT,
+        ERROR_INDICATE_TIMEOUT,
+        ERROR_INDICATE_FAILURE
+    } Status;
+
+    virtual ~NimBLECharacteristicCallbacks() {};
+    virtual void onRead(NimBLECharacteristic *pCharacteristic) {};
+    virtual void onRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc) {};
+    virtual void onWrite(NimBLECharacteristic *pCharacteristic) {};
+    virtual void onWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc) {};
+    virtual void onNotify(NimBLECharacteristic *pCharacteristic) {};
+    virtual void onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code) {};
+    virtual void onSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue) {};
+};
+
+class NimBLECharacteristic
+{
+public:
+    NimBLECharacteristic(const std::string &uuid, uint32_t properties, uint16_t handle)
+        : uuid(uuid), properties(properties), handle(handle) {};
+
+    NimBLEAttValue getValue(time_t *timestamp = nullptr)
+    {
+        return NimBLEAttValue(value.data(), value.size());
+    };
+
+    void setValue(const uint8_t *data, size_t size)
+    {
+        value.assign(data, data + size);
+    };
+
+    void setCallbacks(NimBLECharacteristicCallbacks *pCallbacks);
+
+    NimBLECharacteristicCallbacks *getCallbacks()
+    {
+        return pCallbacks;
+    };
+
+    uint16_t getHandle()
+    {
+        return handle;
+    };
+
+    const std::string uuid;
+    const uint32_t properties;
+
+private:
+    uint16_t handle;
+    std::vector<uint8_t> value;
+    NimBLECharacteristicCallbacks *pCallbacks = nullptr;
+};
+
+class NimBLEService
+{
+public:
+    ~NimBLEService();
+    NimBLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties, uint16_t maxLen = 512);
+    bool start()
+    {
+        return true;
+    };
+    std::vector<NimBLECharacteristic *> characteristics;
+};
+
+class NimBLEAdvertising
+{
+public:
+    void addServiceUUID(const char *uuid) {};
+    void setMinInterval(uint16_t interval) {};
+    void setMaxInterval(uint16_t interval) {};
+    bool start(uint32_t duration = 0, void (*callback)(NimBLEAdvertising *) = nullptr)
+    {
+        advertising = true;
+        return true;
+    };
+    bool stop()
+    {
+        advertising = false;
+        return true;
+    };
+    bool isAdvertising()
+    {
+        return advertising;
+    };
+
+private:
+    bool advertising = false;
+};
+
+class NimBLEServerCallbacks
+{
+public:
+    virtual ~NimBLEServerCallbacks() {};
+    virtual void onConnect(NimBLEServer *pServer) {};
+    virtual void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {};
+    virtual void onDisconnect(NimBLEServer *pServer) {};
+    virtual void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {};
+    virtual void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) {};
+    virtual uint32_t onPassKeyRequest()
+    {
+        return 0;
+    };
+    virtual void onAuthenticationComplete(ble_gap_conn_desc *desc) {};
+    virtual bool onConfirmPIN(uint32_t pin)
+    {
+        return true;
+    };
+};
+
+class NimBLEServer
+{
+public:
+    ~NimBLEServer();
+    NimBLEService *createService(const char *uuid);
+    NimBLEAdvertising *getAdvertising()
+    {
+        return &advertising;
+    };
+    void setCallbacks(NimBLEServerCallbacks *pCallbacks, bool deleteCallbacks = true)
+    {
+        this->pCallbacks = pCallbacks;
+    };
+    NimBLEServerCallbacks *getCallbacks()
+    {
+        return pCallbacks;
+    };
+    bool startAdvertising()
+    {
+        return advertising.start();
+    };
+    size_t getConnectedCount();
+    int disconnect(uint16_t connHandle, uint8_t reason = 0x13);
+    uint16_t getPeerMTU(uint16_t connHandle);
+    void updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {};
+    void setDataLen(uint16_t connHandle, uint16_t txOctets) {};
+
+    std::vector<NimBLEService *> services;
+
+private:
+    NimBLEAdvertising advertising;
+    NimBLEServerCallbacks *pCallbacks = nullptr;
+};
+
+class NimBLEDevice
+{
+public:
+    static void init(const std::string &deviceName) {};
+    static NimBLEServer *createServer();
+    static NimBLEServer *getServer();
+    static int setMTU(uint16_t mtu)
+    {
+        return 0;
+    };
+    static NimBLEAdvertising *getAdvertising()
+    {
+        return createServer()->getAdvertising();
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Simulation of the peer and the BLE stack
+//-----------------------------------------------------------------------------
+
+namespace NimBLEMock
+{
+    /**
+     * @brief A notification handed to the BLE stack
+     *
+     */
+    typedef struct
+    {
+        uint16_t connHandle;
+        uint16_t attHandle;
+        std::vector<uint8_t> data;
+    } Notification_t;
+
+    /**
+     * @brief Connect a peer (server callbacks are called)
+     *
+     * @param connHandle Connection handle
+     * @param mtu ATT_MTU of the connection
+     */
+    void connect(uint16_t connHandle, uint16_t mtu = BLE_ATT_MTU_DFLT);
+
+    /**
+     * @brief Disconnect a peer (server callbacks are called)
+     *
+     * @param connHandle Connection handle
+     */
+    void disconnect(uint16_t connHandle);
+
+    /**
+     * @brief Find a characteristic by UUID
+     *
+     * @param uuid UUID
+     * @return NimBLECharacteristic* Characteristic or nullptr if not found
+     */
+    NimBLECharacteristic *find(const char *uuid);
+
+    /**
+     * @brief Subscribe a peer to (or unsubscribe from) a characteristic
+     *
+     * @param uuid UUID of the characteristic
+     * @param connHandle Connection handle
+     * @param subValue Value of the CCCD (1 = notifications, 0 = none)
+     */
+    void subscribe(const char *uuid, uint16_t connHandle, uint16_t subValue = 1);
+
+    /**
+     * @brief Write to a characteristic as a peer
+     *
+     * @param uuid UUID of the characteristic
+     * @param connHandle Connection handle
+     * @param data Written bytes
+     * @param size Count of written bytes
+     */
+    void write(const char *uuid, uint16_t connHandle, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Report the completion of a notification (NOTIFY_TX GAP event)
+     *
+     * @param uuid UUID of the characteristic
+     * @param status Zero on success
+     */
+    void notifyComplete(const char *uuid, int status = 0);
+
+    /**
+     * @brief Make the next calls to ble_gattc_notify_custom() fail
+     *
+     * @param rc Result code (for example, BLE_HS_ENOMEM)
+     * @param count Count of failing calls
+     */
+    void failNotifications(int rc, size_t count);
+
+    /**
+     * @brief Get and forget the notifications handed to the BLE stack
+     *
+     * @return std::vector<Notification_t> Notifications in order
+     */
+    std::vector<Notification_t> takeNotifications();
+
+    /**
+     * @brief Count of calls to ble_gattc_notify_custom(), including failures
+     *
+     */
+    size_t getNotifyCallCount();
+
+    /**
+     * @brief Connection handles given to NimBLEServer::disconnect()
+     *
+     */
+    std::vector<uint16_t> takeDisconnectRequests();
+}
+
+#endif
@@ -0,0 +1,259 @@
+/**
+ * @file NimBLEMock.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of NimBLE-Arduino 1.4 (the subset used by this library)
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <map>
+#include <mutex>
+#include "NimBLEDevice.h"
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+struct os_mbuf
+{
+    std::vector<uint8_t> data;
+};
+
+// Note: as in NimBLE-Arduino, characteristics without callbacks get these
+static NimBLECharacteristicCallbacks defaultCallbacks;
+
+static std::mutex stackMutex;
+static NimBLEServer *pTheServer = nullptr;
+static std::map<uint16_t, uint16_t> connections; // handle to ATT_MTU
+static std::vector<NimBLEMock::Notification_t> notifications;
+static std::vector<uint16_t> disconnectRequests;
+static int failureCode = 0;
+static size_t failureCount = 0;
+static size_t notifyCallCount = 0;
+static uint16_t nextAttHandle = 0x10;
+
+static ble_gap_conn_desc getDescriptor(uint16_t connHandle)
+{
+    ble_gap_conn_desc desc = {};
+    desc.conn_handle = connHandle;
+    desc.conn_itvl = 24;
+    desc.conn_latency = 0;
+    desc.supervision_timeout = 400;
+    return desc;
+}
+
+//-----------------------------------------------------------------------------
+// Host stack
+//-----------------------------------------------------------------------------
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    os_mbuf *om = new os_mbuf();
+    om->data.assign((const uint8_t *)buf, (const uint8_t *)buf + len);
+    return om;
+}
+
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om)
+{
+    // Note: the mbuf is consumed even on failure, as in NimBLE
+    std::lock_guard<std::mutex> lock(stackMutex);
+    notifyCallCount++;
+    int rc = 0;
+    if (failureCount > 0)
+    {
+        failureCount--;
+        rc = failureCode;
+    }
+    else if (connections.find(conn_handle) == connections.end())
+        rc = BLE_HS_ENOTCONN;
+    else
+        notifications.push_back({conn_handle, att_handle, om->data});
+    delete om;
+    return rc;
+}
+
+int ble_gap_set_prefered_le_phy(uint16_t conn_handle, uint8_t tx_phys_mask, uint8_t rx_phys_mask, uint16_t phy_opts)
+{
+    return 0;
+}
+
+int ble_gattc_exchange_mtu(uint16_t conn_handle, void *cb, void *cb_arg)
+{
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// NimBLE-Arduino
+//-----------------------------------------------------------------------------
+
+void NimBLECharacteristic::setCallbacks(NimBLECharacteristicCallbacks *pCallbacks)
+{
+    this->pCallbacks = pCallbacks ? pCallbacks : &defaultCallbacks;
+}
+
+NimBLEService::~NimBLEService()
+{
+    for (NimBLECharacteristic *pCharacteristic : characteristics)
+        delete pCharacteristic;
+}
+
+NimBLECharacteristic *NimBLEService::createCharacteristic(const char *uuid, uint32_t properties, uint16_t maxLen)
+{
+    NimBLECharacteristic *pCharacteristic = new NimBLECharacteristic(uuid, properties, nextAttHandle);
+    nextAttHandle += 2;
+    pCharacteristic->setCallbacks(nullptr);
+    characteristics.push_back(pCharacteristic);
+    return pCharacteristic;
+}
+
+NimBLEServer::~NimBLEServer()
+{
+    for (NimBLEService *pService : services)
+        delete pService;
+}
+
+NimBLEService *NimBLEServer::createService(const char *uuid)
+{
+    NimBLEService *pService = new NimBLEService();
+    services.push_back(pService);
+    return pService;
+}
+
+size_t NimBLEServer::getConnectedCount()
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return connections.size();
+}
+
+int NimBLEServer::disconnect(uint16_t connHandle, uint8_t reason)
+{
+    // Note: the disconnection event comes later (see NimBLEMock::disconnect())
+    std::lock_guard<std::mutex> lock(stackMutex);
+    disconnectRequests.push_back(connHandle);
+    return 0;
+}
+
+uint16_t NimBLEServer::getPeerMTU(uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    auto item = connections.find(connHandle);
+    return (item == connections.end()) ? 0 : item->second;
+}
+
+NimBLEServer *NimBLEDevice::createServer()
+{
+    if (!pTheServer)
+        pTheServer = new NimBLEServer();
+    return pTheServer;
+}
+
+NimBLEServer *NimBLEDevice::getServer()
+{
+    return pTheServer;
+}
+
+//-----------------------------------------------------------------------------
+// Simulation of the peer and the BLE stack
+//-----------------------------------------------------------------------------
+
+void NimBLEMock::connect(uint16_t connHandle, uint16_t mtu)
+{
+    {
+        std::lock_guard<std::mutex> lock(stackMutex);
+        connections[connHandle] = mtu;
+    }
+    // Note: advertising stops on connection
+    pTheServer->getAdvertising()->stop();
+    ble_gap_conn_desc desc = getDescriptor(connHandle);
+    NimBLEServerCallbacks *pCallbacks = pTheServer->getCallbacks();
+    if (pCallbacks)
+    {
+        pCallbacks->onConnect(pTheServer);
+        pCallbacks->onConnect(pTheServer, &desc);
+    }
+}
+
+void NimBLEMock::disconnect(uint16_t connHandle)
+{
+    {
+        std::lock_guard<std::mutex> lock(stackMutex);
+        connections.erase(connHandle);
+    }
+    ble_gap_conn_desc desc = getDescriptor(connHandle);
+    NimBLEServerCallbacks *pCallbacks = pTheServer->getCallbacks();
+    if (pCallbacks)
+    {
+        pCallbacks->onDisconnect(pTheServer);
+        pCallbacks->onDisconnect(pTheServer, &desc);
+    }
+}
+
+NimBLECharacteristic *NimBLEMock::find(const char *uuid)
+{
+    if (pTheServer)
+        for (NimBLEService *pService : pTheServer->services)
+            for (NimBLECharacteristic *pCharacteristic : pService->characteristics)
+                if (pCharacteristic->uuid == uuid)
+                    return pCharacteristic;
+    return nullptr;
+}
+
+void NimBLEMock::subscribe(const char *uuid, uint16_t connHandle, uint16_t subValue)
+{
+    NimBLECharacteristic *pCharacteristic = find(uuid);
+    ble_gap_conn_desc desc = getDescriptor(connHandle);
+    if (pCharacteristic)
+        pCharacteristic->getCallbacks()->onSubscribe(pCharacteristic, &desc, subValue);
+}
+
+void NimBLEMock::write(const char *uuid, uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    NimBLECharacteristic *pCharacteristic = find(uuid);
+    ble_gap_conn_desc desc = getDescriptor(connHandle);
+    if (pCharacteristic)
+    {
+        pCharacteristic->setValue(data, size);
+        pCharacteristic->getCallbacks()->onWrite(pCharacteristic, &desc);
+    }
+}
+
+void NimBLEMock::notifyComplete(const char *uuid, int status)
+{
+    NimBLECharacteristic *pCharacteristic = find(uuid);
+    if (pCharacteristic)
+        pCharacteristic->getCallbacks()->onStatus(
+            pCharacteristic,
+            (status == 0) ? NimBLECharacteristicCallbacks::Status::SUCCESS_NOTIFY : NimBLECharacteristicCallbacks::Status::ERROR_GATT,
+            status);
+}
+
+void NimBLEMock::failNotifications(int rc, size_t count)
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    failureCode = rc;
+    failureCount = count;
+}
+
+std::vector<NimBLEMock::Notification_t> NimBLEMock::takeNotifications()
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    std::vector<Notification_t> result;
+    result.swap(notifications);
+    return result;
+}
+
+size_t NimBLEMock::getNotifyCallCount()
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return notifyCallCount;
+}
+
+std::vector<uint16_t> NimBLEMock::takeDisconnectRequests()
+{
+    std::lock_guard<std::mutex> lock(stackMutex);
+    std::vector<uint16_t> result;
+    result.swap(disconnectRequests);
+    return result;
+}
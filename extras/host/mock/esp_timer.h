@@ -0,0 +1,22 @@
+/**
+ * @file esp_timer.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of the ESP32 high resolution timer
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_ESP_TIMER_H__
+#define __MOCK_ESP_TIMER_H__
+
+#include <cstdint>
+
+/**
+ * @brief Microseconds since start
+ *
+ */
+int64_t esp_timer_get_time();
+
+#endif
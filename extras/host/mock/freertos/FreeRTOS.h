@@ -0,0 +1,61 @@
+/**
+ * @file FreeRTOS.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS (the subset used by this library)
+ *
+ * @note Implemented with standard C++ threads. One tick is one millisecond.
+ *       Timers never fire on their own: see mockRunTimers().
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_FREERTOS_H__
+#define __MOCK_FREERTOS_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define tskIDLE_PRIORITY 0
+#define configMAX_PRIORITIES 25
+
+// Note: storage of static objects is not used by the mock
+typedef struct
+{
+    void *unused;
+} StaticSemaphore_t;
+typedef StaticSemaphore_t StaticQueue_t;
+typedef StaticSemaphore_t StaticTask_t;
+typedef StaticSemaphore_t StaticEventGroup_t;
+typedef StaticSemaphore_t StaticTimer_t;
+typedef StaticSemaphore_t StaticStreamBuffer_t;
+typedef StaticStreamBuffer_t StaticMessageBuffer_t;
+typedef uint32_t StackType_t;
+
+typedef void *SemaphoreHandle_t;
+typedef void *QueueHandle_t;
+typedef void *TaskHandle_t;
+typedef void *EventGroupHandle_t;
+typedef void *TimerHandle_t;
+typedef void *MessageBufferHandle_t;
+
+TickType_t xTaskGetTickCount();
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * @file event_groups.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS event groups
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_EVENT_GROUPS_H__
+#define __MOCK_EVENT_GROUPS_H__
+
+#include "FreeRTOS.h"
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(
+    EventGroupHandle_t group,
+    EventBits_t bits,
+    BaseType_t clearOnExit,
+    BaseType_t waitForAll,
+    TickType_t ticks);
+void vEventGroupDelete(EventGroupHandle_t group);
+
+#endif
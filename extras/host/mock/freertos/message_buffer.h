@@ -0,0 +1,25 @@
+/**
+ * @file message_buffer.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS message buffers
+ *
+ * @note As in FreeRTOS, every message takes sizeof(size_t) extra bytes.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_MESSAGE_BUFFER_H__
+#define __MOCK_MESSAGE_BUFFER_H__
+
+#include "FreeRTOS.h"
+
+MessageBufferHandle_t xMessageBufferCreate(size_t size);
+size_t xMessageBufferSend(MessageBufferHandle_t buffer, const void *data, size_t size, TickType_t ticks);
+size_t xMessageBufferReceive(MessageBufferHandle_t buffer, void *data, size_t size, TickType_t ticks);
+size_t xMessageBufferSpacesAvailable(MessageBufferHandle_t buffer);
+BaseType_t xMessageBufferReset(MessageBufferHandle_t buffer);
+void vMessageBufferDelete(MessageBufferHandle_t buffer);
+
+#endif
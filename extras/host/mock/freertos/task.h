@@ -0,0 +1,31 @@
+/**
+ * @file task.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS tasks
+ *
+ * @note Tasks are detached threads. Priority, stack size and core are ignored.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_TASK_H__
+#define __MOCK_TASK_H__
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char *name,
+    uint32_t stackSize,
+    void *parameter,
+    UBaseType_t priority,
+    TaskHandle_t *handle,
+    BaseType_t coreID);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file timers.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side mock of FreeRTOS software timers
+ *
+ * @note Expired timers are fired by mockRunTimers() at the calling thread.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __MOCK_TIMERS_H__
+#define __MOCK_TIMERS_H__
+
+#include "FreeRTOS.h"
+
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t xTimerCreateStatic(
+    const char *name,
+    TickType_t period,
+    UBaseType_t autoReload,
+    void *id,
+    TimerCallbackFunction_t callback,
+    StaticTimer_t *buffer);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks);
+
+/**
+ * @brief Fire expired timers (mock only)
+ *
+ * @return size_t Count of fired timers
+ */
+size_t mockRunTimers();
+
+#endif
@@ -0,0 +1,301 @@
+/**
+ * @file test_at_parser.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side automated test of the AT command parser
+ *
+ * @note Based on extras/test/ATCommandsTester, with no hardware.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "NuATCommandParser.hpp"
+#include "NuHostTest.hpp"
+
+//-----------------------------------------------------------------------------
+// MOCK
+//-----------------------------------------------------------------------------
+
+class NuATCommandTester : public NuATCommandParser, NuATCommandCallbacks
+{
+public:
+    NuATCommandResult_t lastResponse;
+    int id = 0;
+    bool bExecute = false;
+    bool bWrite = false;
+    bool bRead = false;
+    bool bTest = false;
+    std::string output;
+    std::string nonATText;
+    std::vector<std::string> parameters;
+    std::vector<NuATCompletionToken_t> tokens;
+    bool bAsync = false;
+
+public:
+    virtual void printATResponse(const char message[]) override
+    {
+        if (holdATResponse(message))
+            return;
+        output.append(message);
+        output.push_back('|');
+    };
+
+    virtual void printResultResponse(const NuATCommandResult_t response) override
+    {
+        lastResponse = response;
+        NuATCommandParser::printResultResponse(response);
+    };
+
+    virtual int getATCommandId(const char commandName[]) override
+    {
+        return id;
+    };
+
+    virtual NuATCommandResult_t onExecute(int commandId) override
+    {
+        bExecute = true;
+        if (bAsync)
+        {
+            tokens.push_back(beginAsync());
+            return AT_RESULT_PENDING;
+        }
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onSet(int commandId, NuATCommandParameters_t &parameters) override
+    {
+        this->parameters.clear();
+        for (const char *param : parameters)
+            this->parameters.push_back(param);
+        bWrite = true;
+        return AT_RESULT_OK;
+    };
+
+    virtual NuATCommandResult_t onQuery(int commandId) override
+    {
+        bRead = true;
+        printATResponse("value");
+        return AT_RESULT_OK;
+    };
+
+    virtual void onTest(int commandId) override
+    {
+        bTest = true;
+    };
+
+    virtual void onNonATCommand(const char text[]) override
+    {
+        nonATText = text;
+    };
+
+public:
+    void reset()
+    {
+        lastResponse = AT_RESULT_OK;
+        id = 0;
+        bExecute = false;
+        bWrite = false;
+        bRead = false;
+        bTest = false;
+        bAsync = false;
+        output.clear();
+        nonATText.clear();
+        parameters.clear();
+        tokens.clear();
+        discardPendingResponses();
+    };
+
+    NuATCommandResult_t test(const char commandLine[])
+    {
+        reset();
+        parseCommandLine(commandLine);
+        return lastResponse;
+    };
+
+    void feed(const char data[])
+    {
+        parseCommandData((const uint8_t *)data, strlen(data));
+    };
+
+    NuATCommandTester()
+    {
+        setATCallbacks(this);
+    };
+
+    using NuATCommandParser::parseCommandLine;
+};
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+static void testSyntax(NuATCommandTester &tester)
+{
+    NU_CHECK(tester.test("AT\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("ATn\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT+\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT$n\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&FF\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT+F\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&+F\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF=\"value\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF=\"value\",1\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF=\"value\",\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF=,1\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+FFFF=,,,\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+F?\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+F=?\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT+F/\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT+F1F\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F;AT&F\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F;&G=1;&H?\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F;&G=1;&H?;\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F;;&H?\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=\"\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F=error\"string\"\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=\"string\"error\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=\"error\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=error\"\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.test("AT&F=\"a \\\\ b\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F=\"a \\, b\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F=\"a \\; b\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F=\"a \\\" b\"\n") == AT_RESULT_OK);
+    NU_CHECK(tester.test("AT&F=\"too long too long too long too long too long too long\"\n") == AT_RESULT_ERROR);
+    NU_CHECK(tester.lastParsingResult != AT_PR_OK);
+}
+
+static void testActions(NuATCommandTester &tester)
+{
+    tester.test("AT&FFF\n");
+    NU_CHECK(!tester.bExecute && !tester.bRead && !tester.bWrite && !tester.bTest);
+    tester.test("AT&F\n");
+    NU_CHECK(tester.bExecute && !tester.bRead && !tester.bWrite && !tester.bTest);
+    tester.test("AT&F?\n");
+    NU_CHECK(!tester.bExecute && tester.bRead && !tester.bWrite && !tester.bTest);
+    tester.test("AT&F=99\n");
+    NU_CHECK(!tester.bExecute && !tester.bRead && tester.bWrite && !tester.bTest);
+    tester.test("AT&F=?\n");
+    NU_CHECK(!tester.bExecute && !tester.bRead && !tester.bWrite && tester.bTest);
+    tester.test("AT&G=?;&F\n");
+    NU_CHECK(tester.bExecute && !tester.bRead && !tester.bWrite && tester.bTest);
+    tester.test("AT&F;&G=99\n");
+    NU_CHECK(tester.bExecute && !tester.bRead && tester.bWrite && !tester.bTest);
+    tester.test("AT+X");
+    NU_CHECK(tester.output == "OK|");
+    tester.test("AT+X?;+Y");
+    NU_CHECK(tester.output == "value|OK|OK|");
+    tester.test("hello");
+    NU_CHECK(tester.nonATText == "hello");
+    NU_CHECK(tester.lastParsingResult == AT_PR_NO_PREAMBLE);
+}
+
+static void testParameters(NuATCommandTester &tester)
+{
+    tester.test("AT&F=1,2,3,4,5\n");
+    NU_CHECK(tester.parameters.size() == 5);
+    NU_CHECK((tester.parameters.size() == 5) && (tester.parameters[4] == "5"));
+    tester.test("AT&F=\"a \\\\ b\"\n");
+    NU_CHECK((tester.parameters.size() == 1) && (tester.parameters[0] == "a \\ b"));
+    tester.test("AT&F=\"a \\, b\"\n");
+    NU_CHECK((tester.parameters.size() == 1) && (tester.parameters[0] == "a , b"));
+    tester.test("AT&F=\"a \\\" b\"\n");
+    NU_CHECK((tester.parameters.size() == 1) && (tester.parameters[0] == "a \" b"));
+    tester.test("AT&F=,,\n");
+    NU_CHECK((tester.parameters.size() == 3) && tester.parameters[0].empty());
+}
+
+static void testLineAssembly(NuATCommandTester &tester)
+{
+    tester.reset();
+    NU_CHECK(tester.lineAssembly(true, 16));
+    tester.feed("AT+A;+");
+    NU_CHECK(!tester.bExecute);
+    tester.feed("B=12,3\r\nAT+B\nhello\n");
+    NU_CHECK(tester.bExecute && tester.bWrite);
+    NU_CHECK(tester.output == "OK|OK|OK|");
+    NU_CHECK(tester.nonATText == "hello");
+    tester.reset();
+    tester.feed("AT+B=0123456789012345678\nAT+A\n");
+    NU_CHECK(tester.output == "ERROR|OK|");
+    NU_CHECK(!tester.bWrite && tester.bExecute);
+    tester.lineAssembly(false);
+}
+
+static void testAsync(NuATCommandTester &tester)
+{
+    // Responses are delivered in order
+    tester.reset();
+    tester.bAsync = true;
+    tester.parseCommandLine("AT+A");
+    tester.bAsync = false;
+    tester.parseCommandLine("AT+B?");
+    NU_CHECK(tester.output.empty());
+    NU_CHECK(tester.tokens.size() == 1);
+    NU_CHECK(tester.complete(tester.tokens[0], AT_RESULT_OK, "done"));
+    NU_CHECK(tester.output == "done|OK|value|OK|");
+    NU_CHECK(!tester.complete(tester.tokens[0], AT_RESULT_OK));
+
+    // Too many pending commands
+    tester.reset();
+    tester.bAsync = true;
+    std::string commandLine = "AT+A";
+    for (int i = 1; i <= AT_MAX_PENDING_COMMANDS; i++)
+        commandLine.append(";+A");
+    tester.parseCommandLine(commandLine.c_str());
+    NU_CHECK(tester.lastParsingResult == AT_PR_TOO_MANY_PENDING);
+    tester.reset();
+}
+
+static void testCommandTable()
+{
+    class Tester : public NuATCommandParser
+    {
+    public:
+        std::string output;
+        virtual void printATResponse(const char message[]) override
+        {
+            output.append(message);
+            output.push_back('|');
+        };
+        using NuATCommandParser::parseCommandLine;
+    } tester;
+
+    static constexpr NuATCommandTableEntry_t table[] = {
+        {"ADD", 1, [](int) { return AT_RESULT_OK; }, nullptr, nullptr, nullptr},
+        {"V", 2, nullptr, [](int, NuATCommandParameters_t &p) { return (p.size() == 2) ? AT_RESULT_OK : AT_RESULT_INVALID_PARAM; }, nullptr, nullptr},
+    };
+    static_assert(NuATCommandTableIsSorted(table), "Unsorted AT command table");
+    tester.setATCommandTable(table);
+    tester.parseCommandLine("AT+ADD;+V=1,2");
+    NU_CHECK(tester.output == "OK|OK|");
+    tester.output.clear();
+    tester.parseCommandLine("AT+V");
+    NU_CHECK(tester.output == "ERROR|");
+    tester.output.clear();
+    tester.parseCommandLine("AT+NONE");
+    NU_CHECK(tester.lastParsingResult == AT_PR_UNSUPPORTED_CMD);
+}
+
+//-----------------------------------------------------------------------------
+// Entry point
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    NuATCommandTester tester;
+    testSyntax(tester);
+    testActions(tester);
+    testParameters(tester);
+    testLineAssembly(tester);
+    testAsync(tester);
+    testCommandTable();
+    return testSummary("test_at_parser");
+}
@@ -0,0 +1,191 @@
+/**
+ * @file test_cli_parser.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side automated test of the shell command parser
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "NuCLIParser.hpp"
+#include "NuHostTest.hpp"
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+static NuCLIParsingResult_t lastError = CLI_PR_OK;
+static std::vector<std::string> lastCommandLine;
+static std::string lastCallback;
+
+static void onParseError(NuCLIParsingResult_t result, size_t index)
+{
+    lastError = result;
+}
+
+static void reset()
+{
+    lastError = CLI_PR_OK;
+    lastCommandLine.clear();
+    lastCallback.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+static void testClassicCallbacks()
+{
+    NuCLIParser parser;
+    parser.onParseError(onParseError);
+    parser
+        .on("led", [](NuCommandLine_t &commandLine)
+            { lastCallback = "led"; lastCommandLine = commandLine; })
+        .onUnknown([](NuCommandLine_t &commandLine)
+                   { lastCallback = "unknown"; lastCommandLine = commandLine; });
+
+    reset();
+    parser.execute("led on");
+    NU_CHECK(lastCallback == "led");
+    NU_CHECK((lastCommandLine.size() == 2) && (lastCommandLine[1] == "on"));
+
+    reset();
+    parser.execute("  LED   \"a b\"  \"\" ");
+    NU_CHECK(lastCallback == "led");
+    NU_CHECK((lastCommandLine.size() == 3) && (lastCommandLine[1] == "a b") && lastCommandLine[2].empty());
+
+    reset();
+    parser.execute("led \"say \"\"hi\"\"\"");
+    NU_CHECK((lastCommandLine.size() == 2) && (lastCommandLine[1] == "say \"hi\""));
+
+    reset();
+    parser.execute("other x");
+    NU_CHECK(lastCallback == "unknown");
+
+    reset();
+    parser.execute("led \"open");
+    NU_CHECK(lastError == CLI_PR_ILL_FORMED_STRING);
+    NU_CHECK(lastCallback.empty());
+
+    reset();
+    parser.execute("led \"a\"b");
+    NU_CHECK(lastError == CLI_PR_ILL_FORMED_STRING);
+
+    reset();
+    parser.execute("   ");
+    NU_CHECK(lastError == CLI_PR_NO_COMMAND);
+
+    reset();
+    parser.caseSensitive(true);
+    parser.execute("LED on");
+    NU_CHECK(lastCallback == "unknown");
+}
+
+static void testManyCommands()
+{
+    NuCLIParser parser;
+    int hit = -1;
+    for (int i = 0; i < 70; i++)
+        parser.on("cmd" + std::to_string(i), [&hit, i](NuCommandLine_t &)
+                  { hit = i; });
+    parser.execute("cmd42 a b");
+    NU_CHECK(hit == 42);
+    parser.execute("CMD7");
+    NU_CHECK(hit == 7);
+    parser.execute("cmd69");
+    NU_CHECK(hit == 69);
+}
+
+static void testViewCallbacks()
+{
+    NuCLIParser parser;
+    parser.onParseError(onParseError);
+    parser
+        .on("set", [](NuCommandLineView_t &commandLine)
+            {
+                lastCallback = "set";
+                lastCommandLine.clear();
+                for (std::string_view item : commandLine)
+                    lastCommandLine.push_back(std::string(item)); })
+        .on("get", [](NuCommandLine_t &commandLine)
+            { lastCallback = "get"; lastCommandLine = commandLine; });
+
+    reset();
+    parser.execute("set key \"a \"\"quoted\"\" value\" 3");
+    NU_CHECK(lastCallback == "set");
+    NU_CHECK((lastCommandLine.size() == 4) && (lastCommandLine[2] == "a \"quoted\" value"));
+
+    // Fallback to classic callbacks
+    reset();
+    parser.execute("get key");
+    NU_CHECK(lastCallback == "get");
+    NU_CHECK((lastCommandLine.size() == 2) && (lastCommandLine[1] == "key"));
+
+#ifdef NUS_STATIC_MEMORY
+    reset();
+    std::string commandLine = "set";
+    for (int i = 0; i < NUS_CLI_MAX_ARGS; i++)
+        commandLine.append(" x");
+    parser.execute(commandLine);
+    NU_CHECK(lastError == CLI_PR_OVERFLOW);
+    NU_CHECK(lastCallback.empty());
+#endif
+}
+
+static void testLineAssembly()
+{
+    NuCLIParser parser;
+    static std::vector<std::string> executed;
+    parser.onParseError(onParseError);
+    parser.onUnknown([](NuCommandLine_t &commandLine)
+                     {
+                         std::string line = commandLine[0];
+                         for (size_t i = 1; i < commandLine.size(); i++)
+                             line.append(" " + commandLine[i]);
+                         executed.push_back(line); });
+
+    // Disabled: each chunk is a whole command line
+    parser.executeData((const uint8_t *)"a b", 3);
+    NU_CHECK((executed.size() == 1) && (executed[0] == "a b"));
+
+    // Lines split across chunks and several lines in a chunk
+    executed.clear();
+    NU_CHECK(parser.lineAssembly(true, 16));
+    const char *chunks[] = {"first ar", "g\r\nsecond\n\nthi", "rd \"x y\"\n"};
+    for (const char *chunk : chunks)
+        parser.executeData((const uint8_t *)chunk, strlen(chunk));
+    NU_CHECK(executed.size() == 3);
+    NU_CHECK((executed.size() == 3) && (executed[0] == "first arg") && (executed[1] == "second") && (executed[2] == "third x y"));
+
+    // Partial lines are retained
+    executed.clear();
+    parser.executeData((const uint8_t *)"pending", 7);
+    NU_CHECK(executed.empty());
+    parser.executeData((const uint8_t *)"\n", 1);
+    NU_CHECK((executed.size() == 1) && (executed[0] == "pending"));
+
+    // Line overflow
+    executed.clear();
+    reset();
+    const char *tooLong = "0123456789abcdefghij\nok\n";
+    parser.executeData((const uint8_t *)tooLong, strlen(tooLong));
+    NU_CHECK(lastError == CLI_PR_OVERFLOW);
+    NU_CHECK((executed.size() == 1) && (executed[0] == "ok"));
+}
+
+//-----------------------------------------------------------------------------
+// Entry point
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    testClassicCallbacks();
+    testManyCommands();
+    testViewCallbacks();
+    testLineAssembly();
+    return testSummary("test_cli_parser");
+}
@@ -0,0 +1,146 @@
+/**
+ * @file test_ring_buffer.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side automated test of the lock-free byte ring
+ *
+ * @note The producer drops the oldest bytes when the ring is full,
+ *       concurrently with the consumer.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <atomic>
+#include <thread>
+#include "NuRingBuffer.hpp"
+#include "NuHostTest.hpp"
+
+#define RING_CAPACITY 64
+#define PRODUCED_BYTES 1000000
+
+//-----------------------------------------------------------------------------
+// Test utilities
+//-----------------------------------------------------------------------------
+
+static NuRingBuffer ring;
+static std::atomic<bool> producing{false};
+
+// Note: bytes are a sequence number modulo 251 (a prime), so any
+// gap is detected within a chunk no longer than the capacity
+static uint8_t sequence(size_t index)
+{
+    return (uint8_t)(index % 251);
+}
+
+static bool isContiguous(const uint8_t *data, size_t size)
+{
+    for (size_t i = 1; i < size; i++)
+        if (data[i] != sequence(data[i - 1] + 1))
+            return false;
+    return true;
+}
+
+static void producer()
+{
+    uint8_t chunk[13];
+    size_t index = 0;
+    while (index < PRODUCED_BYTES)
+    {
+        for (size_t i = 0; i < sizeof(chunk); i++)
+            chunk[i] = sequence(index + i);
+        size_t count = ring.write(chunk, sizeof(chunk));
+        if (count < sizeof(chunk))
+        {
+            // Drop the oldest bytes to make room
+            ring.discard(sizeof(chunk) - count);
+            count += ring.write(chunk + count, sizeof(chunk) - count);
+        }
+        index += count;
+        // Note: give the consumer a chance on single-core hosts
+        if ((index % 1024) < sizeof(chunk))
+            std::this_thread::yield();
+    }
+    producing = false;
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+static void testSequential()
+{
+    NU_CHECK(ring.setCapacity(RING_CAPACITY - 1));
+    NU_CHECK(ring.capacity() == RING_CAPACITY);
+    NU_CHECK(ring.peek() == -1);
+
+    uint8_t data[RING_CAPACITY + 1];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = sequence(i);
+    NU_CHECK(ring.write(data, sizeof(data)) == RING_CAPACITY);
+    NU_CHECK(ring.available() == RING_CAPACITY);
+    NU_CHECK(ring.freeSpace() == 0);
+    NU_CHECK(ring.discard(4) == 4);
+    NU_CHECK(ring.peek() == sequence(4));
+
+    uint8_t result[RING_CAPACITY];
+    bool found;
+    NU_CHECK(ring.readUntil(sequence(10), result, sizeof(result), found) == 6);
+    NU_CHECK(found);
+    NU_CHECK(ring.read(result, sizeof(result)) == RING_CAPACITY - 11);
+    NU_CHECK(result[0] == sequence(11));
+    NU_CHECK(ring.available() == 0);
+}
+
+static void testConcurrentDropOldest()
+{
+    NU_CHECK(ring.setCapacity(RING_CAPACITY));
+    producing = true;
+    std::thread producerThread(producer);
+    while (ring.available() == 0)
+        std::this_thread::yield();
+
+    uint8_t chunk[RING_CAPACITY];
+    size_t readCount = 0;
+    size_t brokenChunks = 0;
+    size_t overflows = 0;
+    bool useReadUntil = false;
+    while (producing || (ring.available() > 0))
+    {
+        if (ring.available() > ring.capacity())
+            overflows++;
+        int next = ring.peek();
+        if ((next < -1) || (next > 255))
+            overflows++;
+        size_t count;
+        if (useReadUntil)
+        {
+            bool found;
+            count = ring.readUntil(0, chunk, sizeof(chunk), found);
+        }
+        else
+            count = ring.read(chunk, sizeof(chunk) / 2);
+        useReadUntil = !useReadUntil;
+        if (!isContiguous(chunk, count))
+            brokenChunks++;
+        readCount += count;
+    }
+    producerThread.join();
+
+    NU_CHECK(overflows == 0);
+    NU_CHECK(brokenChunks == 0);
+    NU_CHECK(readCount > 0);
+    NU_CHECK(readCount <= PRODUCED_BYTES);
+    std::printf("Concurrent drop-oldest: %zu of %d bytes read\n", readCount, PRODUCED_BYTES);
+}
+
+//-----------------------------------------------------------------------------
+// MAIN
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    testSequential();
+    testConcurrentDropOldest();
+    return testSummary("test_ring_buffer");
+}
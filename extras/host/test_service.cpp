@@ -0,0 +1,251 @@
+/**
+ * @file test_service.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Host-side automated test of the Nordic UART Service
+ *
+ * @note Runs against the NimBLE and FreeRTOS mocks found at ./mock.
+ *       The test plays the role of the peers.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include "NuS.hpp"
+#include "NuHostTest.hpp"
+
+#define TX_UUID "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define RX_UUID "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+
+//-----------------------------------------------------------------------------
+// MOCK
+//-----------------------------------------------------------------------------
+
+class NuServiceTester : public NordicUARTService
+{
+public:
+    std::string received;
+
+    using NordicUARTService::beginBatch;
+    using NordicUARTService::endBatch;
+
+    virtual void onReceive(const uint8_t *data, size_t size) override
+    {
+        received.append((const char *)data, size);
+    };
+};
+
+NuServiceTester tester;
+
+//-----------------------------------------------------------------------------
+// Test utilities
+//-----------------------------------------------------------------------------
+
+static uint16_t getTxHandle()
+{
+    return NimBLEMock::find(TX_UUID)->getHandle();
+}
+
+static std::string takeSentText(uint16_t connHandle)
+{
+    std::string result;
+    for (const NimBLEMock::Notification_t &notification : NimBLEMock::takeNotifications())
+        if ((notification.connHandle == connHandle) && (notification.attHandle == getTxHandle()))
+            result.append(notification.data.begin(), notification.data.end());
+    return result;
+}
+
+static void peerWrites(const char *uuid, uint16_t connHandle, const char *text)
+{
+    NimBLEMock::write(uuid, connHandle, (const uint8_t *)text, strlen(text));
+}
+
+static size_t getRetryCount()
+{
+    NuStats_t stats;
+    tester.getStats(stats);
+    return stats.txRetries;
+}
+
+/**
+ * @brief Time taken by a write when the first notification fails
+ *
+ * @param rc Result code of the failed notification
+ * @param completionDelayMillis Delay of a notification completion, or zero for none
+ * @return unsigned long Elapsed milliseconds
+ */
+static unsigned long timeCongestedWrite(int rc, unsigned long completionDelayMillis)
+{
+    std::thread completion;
+    NimBLEMock::failNotifications(rc, 1);
+    auto start = std::chrono::steady_clock::now();
+    if (completionDelayMillis)
+        completion = std::thread(
+            [completionDelayMillis]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(completionDelayMillis));
+                NimBLEMock::notifyComplete(TX_UUID);
+            });
+    NU_CHECK(tester.send("retried") == 7);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (completion.joinable())
+        completion.join();
+    NU_CHECK(takeSentText(3) == "retried");
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+static void testSubscription()
+{
+    NimBLEMock::connect(1, 100);
+    NU_CHECK(tester.isConnected(1));
+
+    // Not subscribed: nothing is sent
+    NU_CHECK(tester.send("lost") == 0);
+    NU_CHECK(takeSentText(1).empty());
+
+    NimBLEMock::subscribe(TX_UUID, 1);
+    NU_CHECK(tester.send("hello") == 5);
+    NU_CHECK(takeSentText(1) == "hello");
+    NU_CHECK(tester.write(1, (const uint8_t *)"world", 5) == 5);
+    NU_CHECK(takeSentText(1) == "world");
+
+    NimBLEMock::subscribe(TX_UUID, 1, 0);
+    NU_CHECK(tester.send("lost") == 0);
+    NU_CHECK(takeSentText(1).empty());
+
+    NimBLEMock::disconnect(1);
+    NU_CHECK(!tester.isConnected());
+}
+
+static void testIncomingData()
+{
+    NimBLEMock::connect(2);
+    tester.received.clear();
+    peerWrites(RX_UUID, 2, "abc");
+    NU_CHECK(tester.received == "abc");
+
+    // The TX characteristic is not writable
+    tester.received.clear();
+    peerWrites(TX_UUID, 2, "xyz");
+    NU_CHECK(tester.received.empty());
+    NimBLEMock::disconnect(2);
+}
+
+static void testCongestion()
+{
+    NimBLEMock::connect(3);
+    NimBLEMock::subscribe(TX_UUID, 3);
+    tester.resetStats();
+
+    // No notification completes: retried after NUS_TX_RETRY_PERIOD at most
+    // Note: this also takes any stale room given before
+    size_t callCount = NimBLEMock::getNotifyCallCount();
+    timeCongestedWrite(BLE_HS_ENOMEM, 0);
+    NU_CHECK(NimBLEMock::getNotifyCallCount() == callCount + 2);
+    NU_CHECK(getRetryCount() == 1);
+
+    // A completed notification gives room back, so there is no need to wait
+    // for the retry period
+    NU_CHECK(timeCongestedWrite(BLE_HS_ENOMEM, 2) < NUS_TX_RETRY_PERIOD);
+    NU_CHECK(getRetryCount() == 2);
+    NU_CHECK(timeCongestedWrite(BLE_HS_EBUSY, 2) < NUS_TX_RETRY_PERIOD);
+    NU_CHECK(getRetryCount() == 3);
+
+    // Other errors are not retried
+    NimBLEMock::failNotifications(BLE_HS_EINVAL, 1);
+    NU_CHECK(tester.send("lost") == 0);
+    NU_CHECK(takeSentText(3).empty());
+    NU_CHECK(getRetryCount() == 3);
+    NimBLEMock::disconnect(3);
+}
+
+static void testTxReady()
+{
+    NimBLEMock::connect(4);
+    tester.waitForEvents(NUS_EVENT_TX_READY, 0);
+
+    NimBLEMock::subscribe(TX_UUID, 4);
+    NU_CHECK(tester.waitForEvents(NUS_EVENT_TX_READY, 0) == NUS_EVENT_TX_READY);
+    NU_CHECK(tester.waitForEvents(NUS_EVENT_TX_READY, 0) == 0);
+
+    NU_CHECK(tester.send("ready") == 5);
+    NU_CHECK(takeSentText(4) == "ready");
+    std::thread completion(
+        []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            NimBLEMock::notifyComplete(TX_UUID);
+        });
+    NU_CHECK(tester.waitForEvents(NUS_EVENT_TX_READY, 100) == NUS_EVENT_TX_READY);
+    completion.join();
+
+    // Failed notifications give no room
+    NimBLEMock::notifyComplete(TX_UUID, BLE_HS_ENOTCONN);
+    NU_CHECK(tester.waitForEvents(NUS_EVENT_TX_READY, 0) == 0);
+    NimBLEMock::disconnect(4);
+}
+
+static void testStatsText()
+{
+    NimBLEMock::connect(5);
+    NimBLEMock::subscribe(TX_UUID, 5);
+    tester.printStats();
+    std::string text = takeSentText(5);
+    NU_CHECK(text.find('\0') == std::string::npos);
+    NU_CHECK(text.find("txRetries=") != std::string::npos);
+    NU_CHECK(text.find("mtu[5]=23\n") != std::string::npos);
+    NU_CHECK(!text.empty() && (text.back() == '\n'));
+    NimBLEMock::disconnect(5);
+}
+
+static void testBatchOwner()
+{
+    NimBLEMock::connect(6);
+    NimBLEMock::subscribe(TX_UUID, 6);
+    tester.beginBatch();
+    NU_CHECK(tester.send("abc") == 3);
+    NU_CHECK(takeSentText(6).empty());
+
+    // Other tasks are not held and do not end the batch
+    std::thread other(
+        []()
+        {
+            tester.beginBatch();
+            NU_CHECK(tester.send("xyz") == 3);
+            NU_CHECK(takeSentText(6) == "abcxyz");
+            tester.endBatch();
+        });
+    other.join();
+    NU_CHECK(tester.send("def") == 3);
+    NU_CHECK(takeSentText(6).empty());
+
+    tester.endBatch();
+    NU_CHECK(takeSentText(6) == "def");
+    NimBLEMock::disconnect(6);
+}
+
+//-----------------------------------------------------------------------------
+// MAIN
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    NimBLEDevice::init("test");
+    tester.start();
+    testSubscription();
+    testIncomingData();
+    testCongestion();
+    testTxReady();
+    testStatsText();
+    testBatchOwner();
+    return testSummary("test_service");
+}
@@ -9,6 +9,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include "NuATCommandParser.hpp"
 
 //-----------------------------------------------------------------------------
@@ -50,6 +51,27 @@ const char *findSuffix(const char *in)
     return in;
 }
 
+// Command not holding a response slot
+#define NO_RESPONSE ((size_t)-1)
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+NuATCommandParser::NuATCommandParser()
+{
+    currentResponse = NO_RESPONSE;
+    allocateWorkspace();
+}
+
+NuATCommandParser::~NuATCommandParser()
+{
+#ifndef NUS_STATIC_MEMORY
+    free(workspace);
+    free(lineBuffer);
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // Parsing machinery
 //-----------------------------------------------------------------------------
@@ -57,10 +79,18 @@ const char *findSuffix(const char *in)
 void NuATCommandParser::parseCommandLine(const char *in)
 {
     lastParsingResult = AT_PR_NO_CALLBACKS;
-    if (!pCmdCallbacks)
+    if (!pCmdCallbacks && !pCmdTable)
         // no callbacks: nothing to do here
         return;
 
+    if (!workspace)
+    {
+        // setBufferSize() was unable to allocate memory
+        lastParsingResult = AT_PR_NO_HEAP;
+        printResultResponse(AT_RESULT_ERROR);
+        return;
+    }
+
     // Detect AT preamble
     if (isATPreamble(in, bLowerCasePreamble))
     {
@@ -81,7 +111,8 @@ void NuATCommandParser::parseCommandLine(const char *in)
         lastParsingResult = AT_PR_NO_PREAMBLE;
         try
         {
-            pCmdCallbacks->onNonATCommand(in);
+            if (pCmdCallbacks)
+                pCmdCallbacks->onNonATCommand(in);
         }
         catch (...)
         {
@@ -98,11 +129,13 @@ void NuATCommandParser::parseCommandLine(const char *in)
         in = parseSingleCommand(in);
         try
         {
-            pCmdCallbacks->onFinished(commandIndex++, lastParsingResult);
+            if (pCmdCallbacks)
+                pCmdCallbacks->onFinished(commandIndex, lastParsingResult);
         }
         catch (...)
         {
         };
+        commandIndex++;
     } while (in);
 }
 
@@ -122,36 +155,33 @@ const char *NuATCommandParser::parseSingleCommand(const char *in)
         {
             // Serial.printf("parseSingleCommand(1): %s. Suffix: %s. Length: %d\n", in + 1, suffix, cmdNameLength);
             // store command name in "cmdName" as a null-terminated string
-            // char cmdName[bufferSize];
-            char *cmdName = (char *)malloc(cmdNameLength + 1);
-            if (!cmdName)
-            {
-                lastParsingResult = AT_PR_NO_HEAP;
-                printResultResponse(AT_RESULT_ERROR);
-                return nullptr;
-            }
-            // memcpy(cmdName, in + 1, cmdNameLength);
-            for (int i = 0; i < cmdNameLength; i++)
-                cmdName[i] = *(in + 1 + i);
+            // Note: cmdNameLength < bufferSize
+            char *cmdName = workspace;
+            memcpy(cmdName, in + 1, cmdNameLength);
             cmdName[cmdNameLength] = '\0';
             // Serial.printf("parseSingleCommand(2): %s. Suffix: %s. Name: %s. Length: %d. pName %d. pIn+1:%d\n", in + 1, suffix, cmdName, cmdNameLength, cmdName, in + 1);
 
             if (isAlphaString(cmdName))
             {
                 // check if command is supported
-                int commandId;
-                try
+                int commandId = -1;
+                pCurrentEntry = findCommand(cmdName);
+                if (pCurrentEntry)
+                    commandId = pCurrentEntry->commandId;
+                else if (pCmdCallbacks)
                 {
-                    commandId = pCmdCallbacks->getATCommandId(cmdName);
-                }
-                catch (...)
-                {
-                    commandId = -1;
+                    try
+                    {
+                        commandId = pCmdCallbacks->getATCommandId(cmdName);
+                    }
+                    catch (...)
+                    {
+                        commandId = -1;
+                    }
                 }
                 if (commandId >= 0)
                 {
                     // continue parsing
-                    free(cmdName);
                     return parseAction(suffix, commandId);
                 }
                 else // this command is not supported
@@ -159,8 +189,6 @@ const char *NuATCommandParser::parseSingleCommand(const char *in)
             }
             else // command name contains non-alphabetic characters
                 lastParsingResult = AT_PR_INVALID_CMD2;
-
-            free(cmdName);
         }
         else // error: no command name, buffer overflow or command name has "&" prefix but more than one letter
             lastParsingResult = AT_PR_INVALID_CMD1;
@@ -184,16 +212,18 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
         // This is a TEST command
         if (isCommandEndToken(in[2]))
         {
+            if (!beginCommand())
+                return rejectCommand();
             NuATCommandResult_t result = AT_RESULT_OK;
             try
             {
-                pCmdCallbacks->onTest(commandId);
+                doTest(commandId);
             }
             catch (...)
             {
                 result = AT_RESULT_ERROR;
             }
-            printResultResponse(result);
+            endCommand(result);
             return followingCommand(in + 2, result);
         } // else syntax error
     }
@@ -202,16 +232,18 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
         // This is a READ/QUERY command
         if (isCommandEndToken(in[1]))
         {
+            if (!beginCommand())
+                return rejectCommand();
             NuATCommandResult_t response;
             try
             {
-                response = pCmdCallbacks->onQuery(commandId);
+                response = doQuery(commandId);
             }
             catch (...)
             {
                 response = AT_RESULT_ERROR;
             }
-            printResultResponse(response);
+            endCommand(response);
             return followingCommand(in + 1, response);
         } // else syntax Error
     }
@@ -223,16 +255,18 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
     else if (isCommandEndToken(in[0]))
     {
         // This is an EXECUTE Command
+        if (!beginCommand())
+            return rejectCommand();
         NuATCommandResult_t response;
         try
         {
-            response = pCmdCallbacks->onExecute(commandId);
+            response = doExecute(commandId);
         }
         catch (...)
         {
             response = AT_RESULT_ERROR;
         }
-        printResultResponse(response);
+        endCommand(response);
         return followingCommand(in, response);
     } // else syntax error
     lastParsingResult = AT_PR_END_TOKEN_EXPECTED;
@@ -245,15 +279,9 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // See https://docs.espressif.com/projects/esp-at/en/release-v2.2.0.0_esp8266/AT_Command_Set/index.html
     // about parameters' syntax.
 
-    NuATCommandParameters_t paramList;
-    // char buffer[bufferSize];
-    char *buffer = (char *)malloc(bufferSize);
-    if (!buffer)
-    {
-        lastParsingResult = AT_PR_NO_HEAP;
-        printResultResponse(AT_RESULT_ERROR);
-        return nullptr;
-    }
+    // Note: paramList capacity is reserved in advance, so no heap allocation happens here
+    paramList.clear();
+    char *buffer = workspace + bufferSize;
     size_t l = 0;
     bool doubleQuotes = false;
     bool syntaxError = false;
@@ -333,7 +361,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // check for syntax errors or missing double quotes in last parameter
     if (syntaxError || doubleQuotes)
     {
-        free(buffer);
         lastParsingResult = AT_PR_ILL_FORMED_STRING;
         printResultResponse(AT_RESULT_ERROR);
         return nullptr;
@@ -342,7 +369,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // check for buffer overflow
     if (l >= bufferSize)
     {
-        free(buffer);
         lastParsingResult = AT_PR_SET_OVERFLOW;
         printResultResponse(AT_RESULT_ERROR);
         return nullptr;
@@ -354,20 +380,148 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // Serial.printf("Last param: %s\n", currentParam);
 
     // Invoke callback
+    if (!beginCommand())
+        return rejectCommand();
     NuATCommandResult_t response;
     try
     {
-        response = pCmdCallbacks->onSet(commandId, paramList);
+        response = doSet(commandId, paramList);
     }
     catch (...)
     {
         response = AT_RESULT_ERROR;
     }
-    free(buffer);
-    printResultResponse(response);
+    endCommand(response);
     return followingCommand(in, response);
 }
 
+//-----------------------------------------------------------------------------
+// Command dispatching
+//-----------------------------------------------------------------------------
+
+const NuATCommandTableEntry_t *NuATCommandParser::findCommand(const char *commandName)
+{
+    // Binary search
+    size_t low = 0;
+    size_t high = cmdTableSize;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        int test = strcmp(commandName, pCmdTable[middle].name);
+        if (test == 0)
+            return &pCmdTable[middle];
+        else if (test < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return nullptr;
+}
+
+// Note: NuATCommandCallbacks is used when the command was not found in the table
+
+NuATCommandResult_t NuATCommandParser::doExecute(int commandId)
+{
+    if (pCurrentEntry)
+        return pCurrentEntry->onExecute ? pCurrentEntry->onExecute(commandId) : AT_RESULT_ERROR;
+    return pCmdCallbacks->onExecute(commandId);
+}
+
+NuATCommandResult_t NuATCommandParser::doSet(int commandId, NuATCommandParameters_t &parameters)
+{
+    if (pCurrentEntry)
+        return pCurrentEntry->onSet ? pCurrentEntry->onSet(commandId, parameters) : AT_RESULT_ERROR;
+    return pCmdCallbacks->onSet(commandId, parameters);
+}
+
+NuATCommandResult_t NuATCommandParser::doQuery(int commandId)
+{
+    if (pCurrentEntry)
+        return pCurrentEntry->onQuery ? pCurrentEntry->onQuery(commandId) : AT_RESULT_ERROR;
+    return pCmdCallbacks->onQuery(commandId);
+}
+
+void NuATCommandParser::doTest(int commandId)
+{
+    if (pCurrentEntry)
+    {
+        if (pCurrentEntry->onTest)
+            pCurrentEntry->onTest(commandId);
+    }
+    else
+        pCmdCallbacks->onTest(commandId);
+}
+
+//-----------------------------------------------------------------------------
+// Line assembly
+//-----------------------------------------------------------------------------
+
+bool NuATCommandParser::lineAssembly(bool enable, size_t maxLineLength)
+{
+#ifndef NUS_STATIC_MEMORY
+    free(lineBuffer);
+#endif
+    lineBuffer = nullptr;
+    lineBufferSize = 0;
+    resetLineAssembly();
+    if (enable)
+    {
+        if (maxLineLength == 0)
+            maxLineLength = 1;
+        // Note: room for the null terminator
+#ifdef NUS_STATIC_MEMORY
+        if (maxLineLength > AT_STATIC_MAX_LINE_LENGTH)
+            maxLineLength = AT_STATIC_MAX_LINE_LENGTH;
+        lineBuffer = staticLineBuffer;
+#else
+        lineBuffer = (char *)malloc(maxLineLength + 1);
+#endif
+        if (!lineBuffer)
+            return false;
+        lineBufferSize = maxLineLength + 1;
+    }
+    return true;
+}
+
+void NuATCommandParser::parseCommandData(const uint8_t *in, size_t size)
+{
+    NUS_STATS(uint64_t startMicros = NUS_STATS_MICROS());
+    if (!lineBuffer)
+    {
+        // Line assembly disabled
+        parseCommandLine((const char *)in);
+        NUS_STATS(NuRecordParseTime(parseStats, startMicros));
+        return;
+    }
+
+    for (size_t index = 0; index < size; index++)
+    {
+        char c = (char)in[index];
+        if ((c == '\r') || (c == '\n'))
+        {
+            // End of line
+            if (bLineOverflow)
+            {
+                lastParsingResult = AT_PR_LINE_OVERFLOW;
+                printResultResponse(AT_RESULT_ERROR);
+            }
+            else if (lineLength > 0)
+            {
+                lineBuffer[lineLength] = '\0';
+                parseCommandLine(lineBuffer);
+            }
+            // else: ignore empty lines
+            resetLineAssembly();
+        }
+        else if (lineLength < (lineBufferSize - 1))
+            lineBuffer[lineLength++] = c;
+        else
+            // Discard until the next line terminator
+            bLineOverflow = true;
+    }
+    NUS_STATS(NuRecordParseTime(parseStats, startMicros));
+}
+
 //-----------------------------------------------------------------------------
 // Buffer size
 //-----------------------------------------------------------------------------
@@ -381,8 +535,48 @@ void NuATCommandParser::setBufferSize(size_t size)
     else
         // absolute minimum
         bufferSize = 5;
+    allocateWorkspace();
+}
+
+#ifdef NUS_STATIC_MEMORY
+
+bool NuATCommandParser::allocateWorkspace()
+{
+    if (bufferSize > AT_STATIC_BUFFER_SIZE)
+        bufferSize = AT_STATIC_BUFFER_SIZE;
+    workspace = staticWorkspace;
+    paramList.clear();
+    return true;
+}
+
+#else
+
+bool NuATCommandParser::allocateWorkspace()
+{
+    free(workspace);
+    // Note: room for the command name and the parameters
+    workspace = (char *)malloc(bufferSize * 2);
+    if (workspace)
+    {
+        try
+        {
+            // Note: every parameter takes at least one byte in the parameter buffer
+            paramList.clear();
+            paramList.shrink_to_fit();
+            paramList.reserve(bufferSize);
+            return true;
+        }
+        catch (...)
+        {
+            free(workspace);
+            workspace = nullptr;
+        }
+    }
+    return false;
 }
 
+#endif
+
 //-----------------------------------------------------------------------------
 // Printing
 //-----------------------------------------------------------------------------
@@ -406,5 +600,191 @@ void NuATCommandParser::printResultResponse(const NuATCommandResult_t response)
     case AT_RESULT_SEND_FAIL:
         printATResponse("SEND FAIL");
         break;
+    case AT_RESULT_PENDING:
+        // Printed on completion
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Asynchronous commands and ordered responses
+//-----------------------------------------------------------------------------
+
+// Note: responseLock must be held
+size_t NuATCommandParser::newResponse(bool done)
+{
+    if (responseCount == AT_MAX_PENDING_COMMANDS)
+        return NO_RESPONSE;
+    size_t slot = (responseHead + responseCount) % AT_MAX_PENDING_COMMANDS;
+    responseCount++;
+    responses[slot].token = 0;
+    responses[slot].async = false;
+    responses[slot].done = done;
+    responses[slot].output.clear();
+    return slot;
+}
+
+bool NuATCommandParser::beginCommand()
+{
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    bExecuting = true;
+    currentResponse = NO_RESPONSE;
+    if (responseCount > 0)
+    {
+        // Previous commands are pending, so this response must be retained
+        currentResponse = newResponse(false);
+        if (currentResponse == NO_RESPONSE)
+        {
+            bExecuting = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *NuATCommandParser::rejectCommand()
+{
+    lastParsingResult = AT_PR_TOO_MANY_PENDING;
+    printResultResponse(AT_RESULT_ERROR);
+    return nullptr;
+}
+
+void NuATCommandParser::endCommand(NuATCommandResult_t result)
+{
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    bExecuting = false;
+    if (currentResponse == NO_RESPONSE)
+    {
+        // Not retained
+        printResultResponse((result == AT_RESULT_PENDING) ? AT_RESULT_ERROR : result);
+        return;
+    }
+
+    Response_t &response = responses[currentResponse];
+    if ((result != AT_RESULT_PENDING) || !response.async)
+    {
+        // Synchronous execution
+        // Note: the response is retained
+        response.token = 0;
+        if (!response.done)
+            printResultResponse((result == AT_RESULT_PENDING) ? AT_RESULT_ERROR : result);
+        response.done = true;
+    }
+    currentResponse = NO_RESPONSE;
+    flushResponses();
+}
+
+NuATCompletionToken_t NuATCommandParser::beginAsync()
+{
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    if (!bExecuting)
+        return 0;
+    if (currentResponse == NO_RESPONSE)
+    {
+        currentResponse = newResponse(false);
+        if (currentResponse == NO_RESPONSE)
+            return 0;
+    }
+    Response_t &response = responses[currentResponse];
+    if (!response.async)
+    {
+        if (++lastToken == 0)
+            lastToken = 1;
+        response.token = lastToken;
+        response.async = true;
+    }
+    return response.token;
+}
+
+bool NuATCommandParser::complete(NuATCompletionToken_t token, NuATCommandResult_t result, const char message[])
+{
+    if ((token == 0) || (result == AT_RESULT_PENDING))
+        return false;
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    for (size_t i = 0; i < responseCount; i++)
+    {
+        size_t slot = (responseHead + i) % AT_MAX_PENDING_COMMANDS;
+        Response_t &response = responses[slot];
+        if (response.token == token)
+        {
+            // Note: retain the response, even if it could be printed now,
+            // so the handler may complete from within.
+            response.token = 0;
+            size_t executing = currentResponse;
+            currentResponse = slot;
+            if (message)
+                printATResponse(message);
+            printResultResponse(result);
+            currentResponse = executing;
+            response.done = true;
+            flushResponses();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NuATCommandParser::holdATResponse(const char message[])
+{
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    if (bFlushing || (responseCount == 0))
+        return false;
+    size_t slot = currentResponse;
+    if (slot == NO_RESPONSE)
+    {
+        // Not a command response (for example, a syntax error):
+        // append to the last response unless it is pending
+        slot = (responseHead + responseCount - 1) % AT_MAX_PENDING_COMMANDS;
+        if (!responses[slot].done)
+            slot = newResponse(true);
+        if (slot == NO_RESPONSE)
+            // Too many responses: print out of order
+            return false;
+    }
+    else if (responses[slot].done)
+        // Already completed from within the handler
+        return false;
+#ifdef NUS_STATIC_MEMORY
+    // Note: responses not fitting are discarded
+    size_t length = strlen(message) + 1;
+    if (length <= responses[slot].output.max_size() - responses[slot].output.size())
+        responses[slot].output.insert(responses[slot].output.end(), message, message + length);
+#else
+    responses[slot].output.append(message);
+    responses[slot].output.push_back('\0');
+#endif
+    return true;
+}
+
+// Note: responseLock must be held
+void NuATCommandParser::flushResponses()
+{
+    bFlushing = true;
+    while ((responseCount > 0) && responses[responseHead].done && (responseHead != currentResponse))
+    {
+        size_t index = 0;
+        while (index < responses[responseHead].output.size())
+        {
+            const char *message = responses[responseHead].output.data() + index;
+            printATResponse(message);
+            index += strlen(message) + 1;
+        }
+        responses[responseHead].output.clear();
+        responseHead = (responseHead + 1) % AT_MAX_PENDING_COMMANDS;
+        responseCount--;
+    }
+    bFlushing = false;
+}
+
+void NuATCommandParser::discardPendingResponses()
+{
+    std::lock_guard<std::recursive_mutex> guard(responseLock);
+    for (size_t i = 0; i < AT_MAX_PENDING_COMMANDS; i++)
+    {
+        responses[i].token = 0;
+        responses[i].output.clear();
     }
+    responseHead = 0;
+    responseCount = 0;
+    currentResponse = NO_RESPONSE;
 }
\ No newline at end of file
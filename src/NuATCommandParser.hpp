@@ -12,6 +12,29 @@
 #define __NUATCOMMANDPARSER_HPP__
 
 #include <vector>
+#include <string>
+#include <mutex>
+#include <stdint.h>
+#include <stddef.h>
+#include "NuSConfig.hpp"
+#include "NuStats.hpp"
+
+/**
+ * @brief Default maximum length of an assembled command line
+ *
+ * @note See NuATCommandParser::lineAssembly()
+ */
+#define AT_DEFAULT_MAX_LINE_LENGTH 256
+
+/**
+ * @brief Maximum count of commands waiting for completion
+ *        or waiting for their turn to respond
+ *
+ * @note See NuATCommandParser::beginAsync()
+ */
+#ifndef AT_MAX_PENDING_COMMANDS
+#define AT_MAX_PENDING_COMMANDS 8
+#endif
 
 /**
  * @brief Pseudo-standardized result of AT command execution
@@ -30,7 +53,9 @@ typedef enum
     /** Command executed with success */
     AT_RESULT_OK = 0,
     /** Command send successfully to a protocol stack but execution pending */
-    AT_RESULT_SEND_OK = 1
+    AT_RESULT_SEND_OK = 1,
+    /** Command execution goes on asynchronously. See NuATCommandParser::beginAsync() */
+    AT_RESULT_PENDING = 2
 } NuATCommandResult_t;
 
 /**
@@ -63,10 +88,93 @@ typedef enum
     /** A string parameter is not properly enclosed between double quotes */
     AT_PR_ILL_FORMED_STRING,
     /** Unable to allocate buffer memory */
-    AT_PR_NO_HEAP
+    AT_PR_NO_HEAP,
+    /** Command line too long (line assembly enabled) */
+    AT_PR_LINE_OVERFLOW,
+    /** Command not executed: too many commands waiting for completion */
+    AT_PR_TOO_MANY_PENDING
 } NuATParsingResult_t;
 
+/**
+ * @brief Identification of a command whose execution goes on asynchronously
+ *
+ * @note Zero is not a valid token.
+ */
+typedef uint32_t NuATCompletionToken_t;
+
+/**
+ * @brief Parameters of an AT set command
+ *
+ * @note A fixed-capacity vector if NUS_STATIC_MEMORY is defined.
+ */
+#ifdef NUS_STATIC_MEMORY
+typedef NuFixedVector<const char *, AT_STATIC_BUFFER_SIZE> NuATCommandParameters_t;
+#else
 typedef std::vector<const char *> NuATCommandParameters_t;
+#endif
+
+/**
+ * @brief Entry of a static AT command table
+ *
+ * @note Any handler may be `nullptr`. In such a case, an error
+ *       response is printed, as NuATCommandCallbacks does by default.
+ *
+ * @note Example of a table placed in flash memory:
+ *       @code {.cpp}
+ *       NuATCommandResult_t onVersion(int commandId) { ... }
+ *
+ *       // Sorted by name (case-sensitive)
+ *       static constexpr NuATCommandTableEntry_t myTable[] = {
+ *           {"ADD", CMD_ADD, onAdd, nullptr, nullptr, nullptr},
+ *           {"V1", CMD_V1, nullptr, onSetV1, onQueryV1, onTestV1},
+ *       };
+ *       static_assert(NuATCommandTableIsSorted(myTable), "Unsorted AT command table");
+ *       @endcode
+ */
+typedef struct
+{
+    /** Command name with no prefix. Table must be sorted by this field. */
+    const char *name;
+    /** Unique (non-negative) identification number passed to handlers */
+    int commandId;
+    /** Handler for commands with no suffix */
+    NuATCommandResult_t (*onExecute)(int commandId);
+    /** Handler for commands with '=' suffix */
+    NuATCommandResult_t (*onSet)(int commandId, NuATCommandParameters_t &parameters);
+    /** Handler for commands with '?' suffix */
+    NuATCommandResult_t (*onQuery)(int commandId);
+    /** Handler for commands with '=?' suffix */
+    void (*onTest)(int commandId);
+} NuATCommandTableEntry_t;
+
+/**
+ * @brief Compare two command names at compile time
+ *
+ * @return int Same sign as `strcmp(a,b)`
+ */
+constexpr int NuATCommandNameCompare(const char *a, const char *b)
+{
+    return ((a[0] == '\0') || (a[0] != b[0]))
+               ? ((unsigned char)a[0] - (unsigned char)b[0])
+               : NuATCommandNameCompare(a + 1, b + 1);
+}
+
+/**
+ * @brief Check at compile time that an AT command table is properly sorted
+ *
+ * @note Intended for `static_assert()`. Duplicated names are not allowed.
+ *
+ * @param table AT command table
+ * @param index Do not use
+ * @return true If @p table is sorted by name with no duplicates
+ */
+template <size_t N>
+constexpr bool NuATCommandTableIsSorted(const NuATCommandTableEntry_t (&table)[N], size_t index = 1)
+{
+    return (index >= N) ||
+           ((NuATCommandNameCompare(table[index - 1].name, table[index].name) < 0) &&
+            NuATCommandTableIsSorted(table, index + 1));
+}
 
 /**
  * @brief Custom AT command processing for your application
@@ -174,6 +282,11 @@ public:
 class NuATCommandParser
 {
 public:
+    NuATCommandParser();
+    NuATCommandParser(const NuATCommandParser &) = delete;
+    void operator=(NuATCommandParser const &) = delete;
+    virtual ~NuATCommandParser();
+
     /**
      * @brief Print a message properly formatted as an AT response
      *
@@ -203,14 +316,51 @@ public:
         pCmdCallbacks = pCallbacks;
     };
 
+    /**
+     * @brief Set a static table of supported AT commands
+     *
+     * @note Command names are resolved by binary search, with
+     *       no call to NuATCommandCallbacks::getATCommandId().
+     *       Names not found in the table are resolved through the
+     *       callbacks set in setATCallbacks() (if any). Callbacks
+     *       will still receive onNonATCommand() and onFinished().
+     *
+     * @note Not thread-safe. Command names are case-sensitive.
+     *
+     * @param table An array of entries sorted by name. Must remain
+     *              valid forever. Should be declared `constexpr` to
+     *              place it in flash memory.
+     */
+    template <size_t N>
+    void setATCommandTable(const NuATCommandTableEntry_t (&table)[N])
+    {
+        setATCommandTable(table, N);
+    };
+
+    /**
+     * @brief Set a static table of supported AT commands
+     *
+     * @param table Pointer to an array of entries sorted by name,
+     *              or nullptr to remove the table.
+     * @param count Count of entries in @p table
+     */
+    void setATCommandTable(const NuATCommandTableEntry_t *table, size_t count)
+    {
+        pCmdTable = table;
+        cmdTableSize = table ? count : 0;
+    };
+
     /**
      * @brief Size of the parsing buffer
      *
      * @note An error response will be printed if command names or
-     *       command parameters exceed this size. Buffer is allocated
-     *       in the heap.
+     *       command parameters exceed this size. A single parsing
+     *       workspace is allocated in the heap when this method is called,
+     *       so no further heap allocation happens while parsing.
      *
-     * @note Default size is 42 bytes
+     * @note Default size is 42 bytes. If NUS_STATIC_MEMORY is defined,
+     *       the workspace is statically allocated and @p size
+     *       is limited to AT_STATIC_BUFFER_SIZE.
      *
      * @param size Size in bytes
      */
@@ -230,6 +380,70 @@ public:
         bLowerCasePreamble = allowOrNot;
     };
 
+    /**
+     * @brief Enable or disable the assembly of command lines
+     *        split across several chunks of incoming data
+     *
+     * @note By default, line assembly is disabled, so each chunk of
+     *       incoming data is parsed as a whole command line.
+     *       When enabled, incoming data is accumulated until a CR or LF
+     *       character is found, so command lines may be longer than
+     *       a single BLE packet and several command lines may be
+     *       sent in a single BLE packet. Empty lines are ignored.
+     *
+     * @note An error response is printed if a command line exceeds
+     *       @p maxLineLength. Such a command line is discarded up to
+     *       the next CR or LF character.
+     *       Should be called before start().
+     *
+     * @param enable True to enable line assembly, false to disable.
+     * @param maxLineLength Maximum length of a command line in bytes,
+     *                      not counting the line terminator.
+     *
+     * @note If NUS_STATIC_MEMORY is defined, the line buffer is statically
+     *       allocated and @p maxLineLength is limited
+     *       to AT_STATIC_MAX_LINE_LENGTH.
+     *
+     * @return true On success.
+     * @return false Not enough memory. Line assembly is disabled.
+     */
+    bool lineAssembly(bool enable, size_t maxLineLength = AT_DEFAULT_MAX_LINE_LENGTH);
+
+    /**
+     * @brief Continue the execution of the current command asynchronously
+     *
+     * @note Call from a command handler, then return AT_RESULT_PENDING.
+     *       Following commands in the command line are executed at once,
+     *       but responses are delivered in order: responses to following
+     *       commands are retained until complete() is called with the returned token.
+     *       Thus, several slow commands in a single command line run concurrently.
+     *
+     * @note Commands following a pending command are executed
+     *       regardless of its final result.
+     *
+     * @return NuATCompletionToken_t A token for complete() or zero if called
+     *                               outside a command handler or there are
+     *                               too many pending commands.
+     */
+    NuATCompletionToken_t beginAsync();
+
+    /**
+     * @brief Finish the execution of a pending command
+     *
+     * @note Thread-safe. May be called from any task, even from within the handler
+     *       that called beginAsync(). Responses of pending commands must be given here,
+     *       not by the means of printATResponse().
+     *
+     * @param token Token returned by beginAsync()
+     * @param result Result of command execution. Must not be AT_RESULT_PENDING.
+     * @param message Optional response to print before the result (may be nullptr).
+     *                Must not contain the CR+LF sequence of characters.
+     * @return true On success
+     * @return false If @p token is not valid, was already completed or the
+     *               pending commands were discarded (for example, due to disconnection).
+     */
+    bool complete(NuATCompletionToken_t token, NuATCommandResult_t result, const char message[] = nullptr);
+
 public:
     /**
      * @brief Check this attribute to know why parsing failed (or not)
@@ -239,18 +453,129 @@ public:
      */
     NuATParsingResult_t lastParsingResult = AT_PR_OK;
 
+#ifdef NUS_ENABLE_STATS
+    /**
+     * @brief Get parse and dispatch time statistics
+     *
+     * @note Available only if NUS_ENABLE_STATS is defined.
+     *
+     * @return const NuParseStats_t& Statistics since start
+     */
+    const NuParseStats_t &getParseStats()
+    {
+        return parseStats;
+    };
+#endif
+
 private:
     NuATCommandCallbacks *pCmdCallbacks = nullptr;
+    const NuATCommandTableEntry_t *pCmdTable = nullptr;
+    size_t cmdTableSize = 0;
+    // Table entry of the command being parsed (if any)
+    const NuATCommandTableEntry_t *pCurrentEntry = nullptr;
     size_t bufferSize = 42;
+    // Parsing workspace: command name buffer, then parameter buffer
+    char *workspace = nullptr;
+    NuATCommandParameters_t paramList;
     bool bLowerCasePreamble = false;
+    // Line assembly
+    char *lineBuffer = nullptr;
+    size_t lineBufferSize = 0;
+#ifdef NUS_STATIC_MEMORY
+    char staticWorkspace[AT_STATIC_BUFFER_SIZE * 2];
+    char staticLineBuffer[AT_STATIC_MAX_LINE_LENGTH + 1];
+#endif
+    size_t lineLength = 0;
+    bool bLineOverflow = false;
+#ifdef NUS_ENABLE_STATS
+    NuParseStats_t parseStats = {};
+#endif
+    // Ordered responses (circular queue)
+    typedef struct
+    {
+        NuATCompletionToken_t token;
+        bool async;
+        bool done;
+        // Null-separated messages
+#ifdef NUS_STATIC_MEMORY
+        NuFixedVector<char, AT_STATIC_RESPONSE_SIZE> output;
+#else
+        std::string output;
+#endif
+    } Response_t;
+
+    std::recursive_mutex responseLock;
+    Response_t responses[AT_MAX_PENDING_COMMANDS];
+    size_t responseHead = 0;
+    size_t responseCount = 0;
+    // Response slot of the command being executed (if any)
+    size_t currentResponse;
+    bool bExecuting = false;
+    bool bFlushing = false;
+    NuATCompletionToken_t lastToken = 0;
 
     const char *parseSingleCommand(const char *in);
     const char *parseAction(const char *in, int commandId);
     const char *parseWriteParameters(const char *in, int commandId);
+    bool allocateWorkspace();
+    const NuATCommandTableEntry_t *findCommand(const char *commandName);
+    NuATCommandResult_t doExecute(int commandId);
+    NuATCommandResult_t doSet(int commandId, NuATCommandParameters_t &parameters);
+    NuATCommandResult_t doQuery(int commandId);
+    void doTest(int commandId);
+    size_t newResponse(bool done);
+    bool beginCommand();
+    void endCommand(NuATCommandResult_t result);
+    const char *rejectCommand();
+    void flushResponses();
 
 protected:
     virtual void printResultResponse(const NuATCommandResult_t response);
     void parseCommandLine(const char *in);
+
+    /**
+     * @brief Parse a chunk of incoming data
+     *
+     * @note If line assembly is disabled, @p in is parsed as a whole
+     *       command line and it must be null-terminated. Otherwise,
+     *       complete command lines are parsed as soon as their line
+     *       terminator is found, and partial lines are retained.
+     *
+     * @param in Pointer to incoming data
+     * @param size Size of @p in in bytes (not counting the null terminator, if any)
+     */
+    void parseCommandData(const uint8_t *in, size_t size);
+
+    /**
+     * @brief Discard any partial command line
+     *
+     * @note Call when the data source is interrupted (for example, on disconnection)
+     */
+    void resetLineAssembly()
+    {
+        lineLength = 0;
+        bLineOverflow = false;
+    };
+
+    /**
+     * @brief Retain a response while previous commands are pending
+     *
+     * @note Implementations of printATResponse() must call this first
+     *       and print nothing if true is returned, so responses are
+     *       delivered in order. See beginAsync().
+     *
+     * @param message Message given to printATResponse()
+     * @return true If @p message was retained, to be printed later
+     * @return false If @p message must be printed now
+     */
+    bool holdATResponse(const char message[]);
+
+    /**
+     * @brief Discard all pending commands along with their retained responses
+     *
+     * @note Call when the data source is interrupted (for example, on disconnection)
+     */
+    void discardPendingResponses();
 };
 
 #endif
\ No newline at end of file
@@ -21,16 +21,27 @@ NuATCommandProcessor &NuATCommands = NuATCommandProcessor::getInstance();
 // NordicUARTService implementation
 //-----------------------------------------------------------------------------
 
-void NuATCommandProcessor::onWrite(NimBLECharacteristic *pCharacteristic)
+void NuATCommandProcessor::onReceive(const uint8_t *data, size_t size)
 {
-    // Incoming data
-    NimBLEAttValue incomingPacket = pCharacteristic->getValue();
-    // const char *in = pCharacteristic->getValue().c_str();
-    const char *in = incomingPacket.c_str();
-    // Serial.printf("onWrite(): %s\n");
-
-    // Parse
-    parseCommandLine(in);
+    // Note: incoming data is null-terminated.
+    // All responses are gathered and sent in as few notifications as possible.
+    if (lineAssemblyResetPending.exchange(false))
+        resetLineAssembly();
+    beginBatch();
+    parseCommandData(data, size);
+    endBatch();
+}
+
+void NuATCommandProcessor::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onDisconnect(pServer, desc);
+    if (!isConnected())
+    {
+        // Note: incoming data may be parsed at another task (see enableRxWorker()),
+        // so the line assembly buffer is reset there
+        lineAssemblyResetPending = true;
+        discardPendingResponses();
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -51,6 +62,8 @@ void NuATCommandProcessor::setATCallbacks(NuATCommandCallbacks *pCallbacks)
 
 void NuATCommandProcessor::printATResponse(const char message[])
 {
+    if (holdATResponse(message))
+        return;
     send("\r\n");
     send(message);
     send("\r\n");
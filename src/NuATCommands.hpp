@@ -40,7 +40,8 @@ public:
 
 public:
     // Overriden Methods
-    virtual void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    virtual void onReceive(const uint8_t *data, size_t size) override;
+    virtual void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
     virtual void printATResponse(const char message[]) override;
 
     /**
@@ -58,6 +59,7 @@ public:
     void setATCallbacks(NuATCommandCallbacks *pCallbacks);
 
 private:
+    std::atomic<bool> lineAssemblyResetPending{false};
     NuATCommandProcessor(){};
 };
 
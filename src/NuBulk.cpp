@@ -0,0 +1,198 @@
+/**
+ * @file NuBulk.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Bulk data transfer based on the Nordic UART Service
+ *        with credit-based flow control
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <exception>
+#include "NuBulk.hpp"
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+NordicUARTBulk &NuBulk = NordicUARTBulk::getInstance();
+
+// Note: a message buffer stores the length of each message, too
+#define CHUNK_OVERHEAD sizeof(size_t)
+#define MAX_WINDOW 1024
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+NordicUARTBulk::NordicUARTBulk() : NordicUARTService()
+{
+    startSignal = xSemaphoreCreateBinaryStatic(&startSignalBuffer);
+    rxWriteWithoutResponse = true;
+    createBuffer(NUS_DEFAULT_BULK_WINDOW);
+}
+
+NordicUARTBulk::~NordicUARTBulk()
+{
+    if (rxBuffer)
+        vMessageBufferDelete(rxBuffer);
+    vSemaphoreDelete(startSignal);
+}
+
+//-----------------------------------------------------------------------------
+// Reception buffer
+//-----------------------------------------------------------------------------
+
+bool NordicUARTBulk::createBuffer(uint16_t window)
+{
+    rxBuffer = xMessageBufferCreate(window * (NUS_MAX_FRAME_SIZE + CHUNK_OVERHEAD));
+    this->window = rxBuffer ? window : 0;
+    return (rxBuffer != nullptr);
+}
+
+void NordicUARTBulk::setWindow(uint16_t window)
+{
+    if (isConnected())
+        throw std::runtime_error("Unable to set the bulk transfer window while connected");
+    if ((window == 0) || (window > MAX_WINDOW))
+        throw std::runtime_error("Invalid bulk transfer window");
+    if (rxBuffer)
+        vMessageBufferDelete(rxBuffer);
+    if (!createBuffer(window))
+        throw std::runtime_error("Not enough memory for the bulk transfer window");
+}
+
+//-----------------------------------------------------------------------------
+// GATT server events
+//-----------------------------------------------------------------------------
+
+void NordicUARTBulk::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onDisconnect(pServer, desc);
+
+    if (!isConnected())
+    {
+        // Awake task at receive()
+        bLinkLost = true;
+        bStartPending = false;
+        if (bReceiving)
+        {
+            uint8_t dummy = 0;
+            xMessageBufferSend(rxBuffer, &dummy, 1, 0);
+        }
+        else
+            xSemaphoreGive(startSignal);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// NordicUARTService implementation
+//-----------------------------------------------------------------------------
+
+void NordicUARTBulk::onReceive(const uint8_t *data, size_t size)
+{
+    if (bReceiving)
+    {
+        // Note: the buffer has room for every chunk the peer was allowed to send
+        if (xMessageBufferSend(rxBuffer, data, size, 0) != size)
+            bOverflow = true;
+        else
+            NUS_STATS(recordRxLevel(window * (NUS_MAX_FRAME_SIZE + CHUNK_OVERHEAD) - xMessageBufferSpacesAvailable(rxBuffer)));
+    }
+    else if ((size == 5) && (data[0] == BULK_MSG_START) && rxBuffer)
+    {
+        totalSize = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+        bStartPending = true;
+        xSemaphoreGive(startSignal);
+    }
+    // else ignore
+}
+
+//-----------------------------------------------------------------------------
+// Control messages
+//-----------------------------------------------------------------------------
+
+void NordicUARTBulk::sendCredit(uint16_t count)
+{
+    uint8_t message[3] = {BULK_MSG_CREDIT, (uint8_t)(count & 0xFF), (uint8_t)(count >> 8)};
+    write(message, sizeof(message));
+}
+
+void NordicUARTBulk::sendStatus(NuBulkResult_t result, uint32_t size)
+{
+    uint8_t message[6] = {
+        BULK_MSG_STATUS,
+        (uint8_t)result,
+        (uint8_t)(size & 0xFF),
+        (uint8_t)((size >> 8) & 0xFF),
+        (uint8_t)((size >> 16) & 0xFF),
+        (uint8_t)(size >> 24)};
+    write(message, sizeof(message));
+}
+
+//-----------------------------------------------------------------------------
+// Transfer
+//-----------------------------------------------------------------------------
+
+NuBulkResult_t NordicUARTBulk::receive(
+    NuBulkSink_t sink,
+    size_t &size,
+    bool fastProfile,
+    unsigned long timeoutMillis)
+{
+    size = 0;
+
+    // Wait for the host to start a transfer
+    while (!bStartPending)
+    {
+        xSemaphoreTake(startSignal, portMAX_DELAY);
+        if (!bStartPending && !isConnected())
+            return BULK_DISCONNECTED;
+    }
+    bStartPending = false;
+    uint32_t total = totalSize;
+    bLinkLost = false;
+    bOverflow = false;
+    xMessageBufferReset(rxBuffer);
+    bReceiving = true;
+
+    NuConnectionProfile_t previousProfile = getConnectionProfile();
+    if (fastProfile)
+        setConnectionProfile(CONN_PROFILE_THROUGHPUT);
+
+    // Note: credits are given in batches to save notifications
+    TickType_t timeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+    uint16_t batch = (window + 1) / 2;
+    uint16_t consumed = 0;
+    NuBulkResult_t result = BULK_OK;
+    sendCredit(window);
+    while (size < total)
+    {
+        size_t length = xMessageBufferReceive(rxBuffer, chunk, sizeof(chunk), timeoutTicks);
+        if (bLinkLost)
+            result = BULK_DISCONNECTED;
+        else if (length == 0)
+            result = BULK_TIMEOUT;
+        else if (bOverflow || (size + length > total))
+            result = BULK_PROTOCOL_ERROR;
+        else if (sink && !sink(chunk, length))
+            result = BULK_SINK_ERROR;
+        if (result != BULK_OK)
+            break;
+
+        size += length;
+        if ((++consumed >= batch) && (size < total))
+        {
+            sendCredit(consumed);
+            consumed = 0;
+        }
+    }
+    bReceiving = false;
+
+    if (result != BULK_DISCONNECTED)
+        sendStatus(result, size);
+    if (fastProfile)
+        setConnectionProfile(previousProfile);
+    return result;
+}
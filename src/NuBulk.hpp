@@ -0,0 +1,173 @@
+/**
+ * @file NuBulk.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Bulk data transfer based on the Nordic UART Service
+ *        with credit-based flow control
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUBULK_HPP__
+#define __NUBULK_HPP__
+
+#include "NuS.hpp"
+
+/**
+ * @brief Default count of chunks in flight
+ *
+ */
+#define NUS_DEFAULT_BULK_WINDOW 8
+
+/**
+ * @brief Default timeout (in milliseconds) to wait for the next chunk
+ *
+ */
+#define NUS_DEFAULT_BULK_TIMEOUT 5000
+
+/**
+ * @brief Type of a control message
+ *
+ * @note Multi-byte fields are little-endian.
+ */
+typedef enum
+{
+    /** Host to device: start a transfer. Followed by the total size (4 bytes). */
+    BULK_MSG_START = 0xB1,
+    /** Device to host: more chunks may be sent. Followed by the count of chunks (2 bytes). */
+    BULK_MSG_CREDIT = 0xC1,
+    /** Device to host: transfer finished. Followed by a NuBulkResult_t (1 byte)
+     *  and the count of bytes received (4 bytes). */
+    BULK_MSG_STATUS = 0xE1
+} NuBulkMessage_t;
+
+/**
+ * @brief Result of a bulk transfer
+ *
+ */
+typedef enum
+{
+    /** All data was received and accepted by the sink */
+    BULK_OK = 0,
+    /** The sink rejected some data */
+    BULK_SINK_ERROR,
+    /** No data received in time */
+    BULK_TIMEOUT,
+    /** The peer sent more data than allowed */
+    BULK_PROTOCOL_ERROR,
+    /** Connection lost */
+    BULK_DISCONNECTED
+} NuBulkResult_t;
+
+/**
+ * @brief Consumer of incoming bulk data
+ *
+ * @note Return false to abort the transfer.
+ */
+typedef std::function<bool(const uint8_t *data, size_t size)> NuBulkSink_t;
+
+/**
+ * @brief Bulk data transfer through BLE and Nordic UART Service
+ *
+ * @note The host sends a BULK_MSG_START message, then raw chunks of
+ *       up to ATT_MTU-3 bytes by the means of writes without response.
+ *       Each chunk takes a credit. The device gives credits in batches
+ *       (BULK_MSG_CREDIT) as chunks are consumed,
+ *       so several chunks are in flight with no acknowledgment each.
+ *       A BULK_MSG_STATUS message is sent at the end.
+ *
+ * @note Intended for a single peer.
+ */
+class NordicUARTBulk : public NordicUARTService
+{
+public:
+    // Singleton pattern
+
+    NordicUARTBulk(const NordicUARTBulk &) = delete;
+    void operator=(NordicUARTBulk const &) = delete;
+
+    /**
+     * @brief Get the instance of the BLE bulk transfer service
+     *
+     * @note No need to use. Use `NuBulk` instead.
+     *
+     * @return NordicUARTBulk&
+     */
+    static NordicUARTBulk &getInstance()
+    {
+        static NordicUARTBulk instance;
+        return instance;
+    };
+
+public:
+    // Overriden Methods
+
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+    void onReceive(const uint8_t *data, size_t size) override;
+
+public:
+    /**
+     * @brief Wait for and run a single transfer (blocking)
+     *
+     * @note The calling task will get blocked until the host starts
+     *       a transfer and that transfer finishes, or the connection is lost.
+     *       @p sink is called at the calling task,
+     *       so it may take some time (for example, `Update.write()`)
+     *       while the next chunks are being received.
+     *
+     * @param[in] sink Consumer of incoming data, chunk by chunk.
+     * @param[out] size Count of bytes given to @p sink.
+     * @param[in] fastProfile If true, CONN_PROFILE_THROUGHPUT is requested
+     *                        for the duration of the transfer.
+     *                        The previous profile is requested again afterwards.
+     *                        See setConnectionProfile().
+     * @param[in] timeoutMillis Maximum time to wait for the next chunk
+     *                          (in milliseconds).
+     * @return NuBulkResult_t Result of the transfer, also sent to the host.
+     */
+    NuBulkResult_t receive(
+        NuBulkSink_t sink,
+        size_t &size,
+        bool fastProfile = true,
+        unsigned long timeoutMillis = NUS_DEFAULT_BULK_TIMEOUT);
+
+    /**
+     * @brief Set the count of chunks in flight
+     *
+     * @note A buffer for @p window chunks of NUS_MAX_FRAME_SIZE bytes
+     *       is allocated just once. Default is NUS_DEFAULT_BULK_WINDOW.
+     *
+     * @param[in] window Count of chunks (from 1 to 1024).
+     *
+     * @throws std::runtime_error If called while a peer is connected,
+     *                            invalid parameters or not enough memory.
+     */
+    void setWindow(uint16_t window);
+
+private:
+    MessageBufferHandle_t rxBuffer = nullptr;
+    uint16_t window = 0;
+    uint8_t chunk[NUS_MAX_FRAME_SIZE];
+    SemaphoreHandle_t startSignal;
+    StaticSemaphore_t startSignalBuffer;
+    std::atomic<bool> bStartPending{false};
+    std::atomic<bool> bReceiving{false};
+    std::atomic<bool> bOverflow{false};
+    std::atomic<bool> bLinkLost{false};
+    uint32_t totalSize = 0;
+
+    bool createBuffer(uint16_t window);
+    void sendCredit(uint16_t count);
+    void sendStatus(NuBulkResult_t result, uint32_t size);
+    NordicUARTBulk();
+    ~NordicUARTBulk();
+};
+
+/**
+ * @brief Singleton instance of the NordicUARTBulk class
+ *
+ */
+extern NordicUARTBulk &NuBulk;
+
+#endif
@@ -24,10 +24,38 @@ NuCLIParser &NuCLIParser::on(const std::string commandName, NuCLICommandCallback
     {
         vsCommandName.push_back(commandName);
         vcbCommand.push_back(callback);
+        vbInline.push_back(false);
+#if __cplusplus >= 201703L
+        vcbCommandView.push_back(nullptr);
+#endif
+        bCommandIndexDirty = true;
     }
     return *this;
 }
 
+#if __cplusplus >= 201703L
+NuCLIParser &NuCLIParser::on(const std::string commandName, NuCLICommandViewCallback_t callback)
+{
+    if (callback && (commandName.length() > 0))
+    {
+        vsCommandName.push_back(commandName);
+        vcbCommand.push_back(nullptr);
+        vbInline.push_back(false);
+        vcbCommandView.push_back(callback);
+        bCommandIndexDirty = true;
+    }
+    return *this;
+}
+#endif
+
+NuCLIParser &NuCLIParser::setInline(const std::string commandName, bool yesOrNo)
+{
+    for (size_t index = 0; index < vsCommandName.size(); index++)
+        if (equalCommandName(commandName.data(), commandName.length(), vsCommandName[index], bCaseSensitive))
+            vbInline[index] = yesOrNo;
+    return *this;
+}
+
 //-----------------------------------------------------------------------------
 // Auxiliary. Taken from an example at O'Really book
 //-----------------------------------------------------------------------------
@@ -56,6 +84,90 @@ bool caseInsCompare(const std::string &s1, const std::string &s2)
 //             equal(s1.begin(), s1.end(), s2.begin(), caseInsCharCompareW));
 // }
 
+//-----------------------------------------------------------------------------
+// Command index
+//-----------------------------------------------------------------------------
+
+// Empty slot in the command index
+#define NO_COMMAND ((size_t)-1)
+
+uint32_t NuCLIParser::hashCommandName(const char *name, size_t length, bool caseSensitive)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = name[i];
+        if (!caseSensitive)
+            c = toupper(c);
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+bool NuCLIParser::equalCommandName(const char *a, size_t aLength, const std::string &b, bool caseSensitive)
+{
+    if (aLength != b.length())
+        return false;
+    if (caseSensitive)
+        return (memcmp(a, b.data(), aLength) == 0);
+    return std::equal(a, a + aLength, b.begin(), caseInsCharCompareN);
+}
+
+void NuCLIParser::buildCommandIndex()
+{
+    // Table size is a power of two, at least twice the count of commands
+    size_t tableSize = 8;
+    while (tableSize < (vsCommandName.size() * 2))
+        tableSize <<= 1;
+    vCommandIndex.assign(tableSize, NO_COMMAND);
+
+    for (size_t index = 0; index < vsCommandName.size(); index++)
+    {
+        const std::string &name = vsCommandName[index];
+        size_t slot = hashCommandName(name.data(), name.length(), bCaseSensitive) & (tableSize - 1);
+        bool duplicate = false;
+        while ((vCommandIndex[slot] != NO_COMMAND) && !duplicate)
+        {
+            // Note: the first registered callback wins
+            duplicate = equalCommandName(name.data(), name.length(), vsCommandName[vCommandIndex[slot]], bCaseSensitive);
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (!duplicate)
+            vCommandIndex[slot] = index;
+    }
+    bCommandIndexDirty = false;
+}
+
+size_t NuCLIParser::findCommand(const char *name, size_t length)
+{
+    if (bCommandIndexDirty)
+        buildCommandIndex();
+    size_t mask = vCommandIndex.size() - 1;
+    size_t slot = hashCommandName(name, length, bCaseSensitive) & mask;
+    while (vCommandIndex[slot] != NO_COMMAND)
+    {
+        size_t index = vCommandIndex[slot];
+        if (equalCommandName(name, length, vsCommandName[index], bCaseSensitive))
+            return index;
+        slot = (slot + 1) & mask;
+    }
+    return NO_COMMAND;
+}
+
+bool NuCLIParser::isInline(const uint8_t *commandLine, size_t size)
+{
+    size_t index = 0;
+    ignoreSeparator(commandLine, size, index);
+    size_t start = index;
+    while (!isSeparator(commandLine, size, index))
+        index++;
+    if (index == start)
+        return false;
+    size_t command = findCommand((const char *)commandLine + start, index - start);
+    return (command != NO_COMMAND) && vbInline[command];
+}
+
 //-----------------------------------------------------------------------------
 // Execute
 //-----------------------------------------------------------------------------
@@ -64,12 +176,33 @@ void NuCLIParser::execute(const uint8_t *commandLine, size_t size)
 {
     if ((vcbCommand.size() == 0) && (!cbUnknown))
     {
-        onParsingFailure(CLI_PR_NO_CALLBACKS, 0);
-        return;
+#if __cplusplus >= 201703L
+        if (!cbUnknownView)
+#endif
+        {
+            onParsingFailure(CLI_PR_NO_CALLBACKS, 0);
+            return;
+        }
     }
 
-    NuCommandLine_t parsedCommandLine;
+    NUS_STATS(uint64_t startMicros = NUS_STATS_MICROS());
     size_t index = 0;
+#if __cplusplus >= 201703L
+    // Note: parsedView is cleared, not freed,
+    // so no heap allocation is needed after the first execution
+    parsedView.clear();
+    NuCLIParsingResult_t parsingResult = parse(commandLine, size, index, parsedView);
+    if (parsingResult == CLI_PR_OK)
+    {
+        if (parsedView.size() == 0)
+            onParsingFailure(CLI_PR_NO_COMMAND, 0);
+        else
+            onParsingSuccess(parsedView);
+    }
+    else
+        onParsingFailure(parsingResult, index);
+#else
+    NuCommandLine_t parsedCommandLine;
     NuCLIParsingResult_t parsingResult = parse(commandLine, size, index, parsedCommandLine);
     if (parsingResult == CLI_PR_OK)
     {
@@ -80,32 +213,100 @@ void NuCLIParser::execute(const uint8_t *commandLine, size_t size)
     }
     else
         onParsingFailure(parsingResult, index);
+#endif
+    NUS_STATS(NuRecordParseTime(parseStats, startMicros));
 }
 
+//-----------------------------------------------------------------------------
+// Line assembly
 //-----------------------------------------------------------------------------
 
-void NuCLIParser::onParsingSuccess(NuCommandLine_t &commandLine)
+bool NuCLIParser::lineAssembly(bool enable, size_t maxLineLength)
 {
-    std::string &givenCommandName = commandLine[0];
-    for (size_t index = 0; index < vsCommandName.size(); index++)
+    bLineAssembly = false;
+    resetLineAssembly();
+    lineBuffer.clear();
+    lineBuffer.shrink_to_fit();
+    if (enable)
     {
-        std::string &candidate = vsCommandName.at(index);
-        bool test;
-        if (bCaseSensitive)
-            test = (candidate.compare(givenCommandName) == 0);
-        else
-            test = caseInsCompare(givenCommandName, candidate);
-        if (test)
+        if (maxLineLength == 0)
+            maxLineLength = 1;
+        try
         {
-            NuCLICommandCallback_t cb = vcbCommand.at(index);
-            cb(commandLine);
-            return;
+            // Note: a NuFixedVector is clamped to its capacity
+            lineBuffer.resize(maxLineLength);
+        }
+        catch (...)
+        {
+            return false;
         }
+        bLineAssembly = true;
+    }
+    return true;
+}
+
+void NuCLIParser::executeData(const uint8_t *data, size_t size)
+{
+    if (!bLineAssembly)
+    {
+        execute(data, size);
+        return;
+    }
+
+    for (size_t index = 0; index < size; index++)
+    {
+        char c = (char)data[index];
+        if ((c == '\r') || (c == '\n'))
+        {
+            // End of line
+            if (bLineOverflow)
+                onParsingFailure(CLI_PR_OVERFLOW, lineLength);
+            else if (lineLength > 0)
+                execute((const uint8_t *)lineBuffer.data(), lineLength);
+            // else: ignore empty lines
+            resetLineAssembly();
+        }
+        else if (lineLength < lineBuffer.size())
+            lineBuffer[lineLength++] = c;
+        else
+            // Discard until the next line terminator
+            bLineOverflow = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void NuCLIParser::onParsingSuccess(NuCommandLine_t &commandLine)
+{
+    std::string &givenCommandName = commandLine[0];
+    size_t index = findCommand(givenCommandName.data(), givenCommandName.length());
+    if ((index != NO_COMMAND) && vcbCommand[index])
+    {
+        vcbCommand[index](commandLine);
+        return;
     }
     if (cbUnknown)
         cbUnknown(commandLine);
 }
 
+#if __cplusplus >= 201703L
+void NuCLIParser::onParsingSuccess(NuCommandLineView_t &commandLine)
+{
+    std::string_view givenCommandName = commandLine[0];
+    size_t index = findCommand(givenCommandName.data(), givenCommandName.length());
+    if ((index != NO_COMMAND) && vcbCommandView[index])
+        vcbCommandView[index](commandLine);
+    else if ((index == NO_COMMAND) && cbUnknownView)
+        cbUnknownView(commandLine);
+    else
+    {
+        // Fallback to classic callbacks
+        NuCommandLine_t copy(commandLine.begin(), commandLine.end());
+        onParsingSuccess(copy);
+    }
+}
+#endif
+
 //-----------------------------------------------------------------------------
 
 void NuCLIParser::onParsingFailure(NuCLIParsingResult_t result, size_t index)
@@ -176,6 +377,90 @@ NuCLIParsingResult_t NuCLIParser::parseNext(const uint8_t *in, size_t size, size
     return CLI_PR_OK;
 }
 
+#if __cplusplus >= 201703L
+NuCLIParsingResult_t NuCLIParser::parse(const uint8_t *in, size_t size, size_t &index, NuCommandLineView_t &parsedCommandLine)
+{
+    // Note: the scratch buffer must not be reallocated while parsing,
+    // since views may point into it. No token is larger than the input.
+#ifdef NUS_STATIC_MEMORY
+    if (size > scratch.max_size())
+        return CLI_PR_OVERFLOW;
+#endif
+    if (scratch.size() < size)
+        scratch.resize(size);
+    size_t scratchLength = 0;
+
+    while (index < size)
+    {
+        ignoreSeparator(in, size, index);
+        if (index >= size)
+            break;
+#ifdef NUS_STATIC_MEMORY
+        if (parsedCommandLine.size() == parsedCommandLine.max_size())
+            return CLI_PR_OVERFLOW;
+#endif
+        const char *start = (const char *)in + index;
+        if (in[index] == '\"')
+        {
+            // Quoted string
+            index++;
+            start++;
+            size_t length = 0;
+            char *unescaped = nullptr;
+            bool openString = true;
+            while ((index < size) && openString)
+            {
+                if (in[index] == '\"')
+                {
+                    index++;
+                    if ((index < size) && (in[index] == '\"'))
+                    {
+                        // Escaped double quotes: move the token to the scratch buffer
+                        if (!unescaped)
+                        {
+                            unescaped = scratch.data() + scratchLength;
+                            memcpy(unescaped, start, length);
+                        }
+                        unescaped[length++] = '\"';
+                        index++;
+                    }
+                    else
+                        // Closing double quotes
+                        openString = false;
+                }
+                else
+                {
+                    if (unescaped)
+                        unescaped[length] = in[index];
+                    length++;
+                    index++;
+                }
+            }
+            if (openString || !isSeparator(in, size, index))
+            {
+                // No closing double quotes or text after closing double quotes
+                return CLI_PR_ILL_FORMED_STRING;
+            }
+            if (unescaped)
+            {
+                scratchLength += length;
+                parsedCommandLine.push_back(std::string_view(unescaped, length));
+            }
+            else
+                parsedCommandLine.push_back(std::string_view(start, length));
+        }
+        else
+        {
+            // Unquoted string
+            while (!isSeparator(in, size, index))
+                index++;
+            parsedCommandLine.push_back(std::string_view(start, (const char *)in + index - start));
+        }
+    }
+    return CLI_PR_OK;
+}
+#endif
+
 bool NuCLIParser::isSeparator(const uint8_t *in, size_t size, size_t index)
 {
     if (index < size)
@@ -197,6 +482,8 @@ void NuCLIParser::ignoreSeparator(const uint8_t *in, size_t size, size_t &index)
 bool NuCLIParser::caseSensitive(bool yesOrNo)
 {
     bool result = bCaseSensitive;
+    if (bCaseSensitive != yesOrNo)
+        bCommandIndexDirty = true;
     bCaseSensitive = yesOrNo;
     return result;
 };
\ No newline at end of file
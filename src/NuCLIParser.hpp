@@ -15,6 +15,18 @@
 #include <string>
 #include <cstring> // Needed for strlen()
 #include <functional>
+#include "NuSConfig.hpp"
+#include "NuStats.hpp"
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+ * @brief Default maximum length of an assembled command line
+ *
+ * @note See NuCLIParser::lineAssembly()
+ */
+#define CLI_DEFAULT_MAX_LINE_LENGTH 256
 
 /**
  * @brief Parsing state of a received command
@@ -30,7 +42,9 @@ typedef enum
     /** Command line is empty */
     CLI_PR_NO_COMMAND,
     /** A string parameter is not properly enclosed between double quotes */
-    CLI_PR_ILL_FORMED_STRING
+    CLI_PR_ILL_FORMED_STRING,
+    /** Too many strings or command line too long (line assembly enabled or NUS_STATIC_MEMORY defined) */
+    CLI_PR_OVERFLOW
 
 } NuCLIParsingResult_t;
 
@@ -50,6 +64,36 @@ typedef std::vector<std::string> NuCommandLine_t;
  */
 typedef std::function<void(NuCommandLine_t &)> NuCLICommandCallback_t;
 
+#if __cplusplus >= 201703L
+/**
+ * @brief Parsed strings in a command line, from left to right,
+ *        with no heap allocation
+ *
+ * @note Same as NuCommandLine_t, but each string is a view into the
+ *       incoming data (or into an internal buffer for quoted strings
+ *       containing escaped double quotes). Views are valid only
+ *       during the callback. Copy them if you need them later.
+ *
+ * @note If NUS_STATIC_MEMORY is defined, this is a fixed-capacity vector
+ *       of NUS_CLI_MAX_ARGS items and command lines are limited to
+ *       NUS_CLI_MAX_LINE_LENGTH bytes. Otherwise, CLI_PR_OVERFLOW is
+ *       reported. Note that callbacks taking a NuCommandLine_t
+ *       still use the heap.
+ */
+#ifdef NUS_STATIC_MEMORY
+typedef NuFixedVector<std::string_view, NUS_CLI_MAX_ARGS> NuCommandLineView_t;
+#else
+typedef std::vector<std::string_view> NuCommandLineView_t;
+#endif
+
+/**
+ * @brief Callback to execute for a parsed command line (no heap allocation)
+ *
+ * @param[in] commandLine Parsed command line.
+ */
+typedef std::function<void(NuCommandLineView_t &)> NuCLICommandViewCallback_t;
+#endif
+
 /**
  * @brief Callback to execute in case of parsing errors
  *
@@ -82,6 +126,10 @@ public:
      * @note If you set two or more callbacks for the same command name,
      *       just the first one will be executed, so don't do that.
      *
+     * @note Command names are resolved through a hash table, which is
+     *       rebuilt at the first execution after any registration.
+     *       Dispatch cost does not depend on the count of commands.
+     *
      * @note Example:
      *       @code {.cpp}
      *       NuShellCommands
@@ -99,6 +147,29 @@ public:
      */
     NuCLIParser &on(const std::string commandName, NuCLICommandCallback_t callback);
 
+#if __cplusplus >= 201703L
+    /**
+     * @brief Set a zero-allocation callback for a command name
+     *
+     * @note Same as on(), but the callback receives views into the
+     *       incoming data instead of copies. Use this for high-rate
+     *       commands, since they do not touch the heap.
+     *
+     * @note Example:
+     *       @code {.cpp}
+     *       NuShellCommands
+     *          .on("mycmd", [](NuCommandLineView_t &commandLine)
+     *           { ...do something...});
+     *       @endcode
+     *
+     * @param[in] commandName Command name
+     * @param[in] callback Function to execute if @p commandName is found
+     *
+     * @return NuCLIParser& This instance. Used to chain calls.
+     */
+    NuCLIParser &on(const std::string commandName, NuCLICommandViewCallback_t callback);
+#endif
+
     /**
      * @brief Set a callback for unknown commands
      *
@@ -113,6 +184,42 @@ public:
         return *this;
     };
 
+#if __cplusplus >= 201703L
+    /**
+     * @brief Set a zero-allocation callback for unknown commands
+     *
+     * @note Takes precedence over the callback given to onUnknown(NuCLICommandCallback_t).
+     *
+     * @param[in] callback Function to execute if the parsed command line contains
+     *                     an unknown command name.
+     *
+     * @return NuCLIParser& This instance. Used to chain calls.
+     */
+    NuCLIParser &onUnknown(NuCLICommandViewCallback_t callback)
+    {
+        cbUnknownView = callback;
+        return *this;
+    };
+#endif
+
+    /**
+     * @brief Mark a command as trivial, so it is executed as soon as received
+     *
+     * @note Relevant only if incoming data is processed at a worker task.
+     *       Trivial commands are executed at the NimBLE task instead,
+     *       as long as the worker is idle.
+     *       See NordicUARTService::enableRxWorker().
+     *       Ignored if line assembly is enabled (see lineAssembly()).
+     *
+     * @note Call after on().
+     *
+     * @param[in] commandName Command name
+     * @param[in] yesOrNo True to execute at the NimBLE task. False, otherwise.
+     *
+     * @return NuCLIParser& This instance. Used to chain calls.
+     */
+    NuCLIParser &setInline(const std::string commandName, bool yesOrNo = true);
+
     /**
      * @brief Set a callback for parsing errors
      *
@@ -154,7 +261,96 @@ public:
             execute((const uint8_t *)commandLine, strlen(commandLine));
     };
 
+    /**
+     * @brief Enable or disable the assembly of command lines
+     *        split across several chunks of incoming data
+     *
+     * @note By default, line assembly is disabled, so each chunk of
+     *       incoming data is executed as a whole command line.
+     *       When enabled, incoming data is accumulated until a CR or LF
+     *       character is found, so command lines may be longer than
+     *       a single BLE packet and several command lines may be
+     *       sent in a single BLE packet. Empty lines are ignored.
+     *
+     * @note A single line buffer is allocated when this method is called,
+     *       so no heap allocation happens per line.
+     *       If NUS_STATIC_MEMORY is defined, @p maxLineLength is limited
+     *       to NUS_CLI_MAX_LINE_LENGTH.
+     *
+     * @note CLI_PR_OVERFLOW is reported if a command line exceeds
+     *       @p maxLineLength. Such a command line is discarded up to
+     *       the next CR or LF character.
+     *       Should be called before start().
+     *
+     * @param enable True to enable line assembly, false to disable.
+     * @param maxLineLength Maximum length of a command line in bytes,
+     *                      not counting the line terminator.
+     *
+     * @return true On success.
+     * @return false Not enough memory. Line assembly is disabled.
+     */
+    bool lineAssembly(bool enable, size_t maxLineLength = CLI_DEFAULT_MAX_LINE_LENGTH);
+
+    /**
+     * @brief Execute a chunk of incoming data
+     *
+     * @note If line assembly is disabled, this is the same as execute().
+     *       Otherwise, complete command lines are executed as soon as
+     *       their line terminator is found, and partial lines are retained.
+     *
+     * @param data Pointer to incoming data
+     * @param size Size in bytes of @p data
+     */
+    void executeData(const uint8_t *data, size_t size);
+
+#ifdef NUS_ENABLE_STATS
+    /**
+     * @brief Get parse and dispatch time statistics
+     *
+     * @note Available only if NUS_ENABLE_STATS is defined.
+     *
+     * @return const NuParseStats_t& Statistics since start
+     */
+    const NuParseStats_t &getParseStats()
+    {
+        return parseStats;
+    };
+#endif
+
 protected:
+    /**
+     * @brief Discard any partial command line
+     *
+     * @note Call when the data source is interrupted (for example, on disconnection)
+     */
+    void resetLineAssembly()
+    {
+        lineLength = 0;
+        bLineOverflow = false;
+    };
+
+    /**
+     * @brief Check if line assembly is enabled
+     *
+     * @return true If enabled
+     * @return false If disabled
+     */
+    bool isLineAssemblyEnabled()
+    {
+        return bLineAssembly;
+    };
+
+    /**
+     * @brief Check if the command name in a command line was marked
+     *        with setInline()
+     *
+     * @param commandLine Pointer to a buffer containing a command line
+     * @param size Size in bytes of @p commandLine
+     * @return true If the first word of @p commandLine is an inline command
+     * @return false Otherwise
+     */
+    bool isInline(const uint8_t *commandLine, size_t size);
+
     static NuCLIParsingResult_t parse(const uint8_t *in, size_t size, size_t &index, NuCommandLine_t &parsedCommandLine);
     static NuCLIParsingResult_t parseNext(const uint8_t *in, size_t size, size_t &index, NuCommandLine_t &parsedCommandLine);
     static void ignoreSeparator(const uint8_t *in, size_t size, size_t &index);
@@ -170,6 +366,28 @@ protected:
      */
     virtual void onParsingSuccess(NuCommandLine_t &commandLine);
 
+#if __cplusplus >= 201703L
+    /**
+     * @brief Parse a command line into views, with no heap allocation
+     *
+     * @note Parsing rules and error indexes are the same as parse().
+     *       Quoted strings containing escaped double quotes are
+     *       unescaped into an internal scratch buffer.
+     */
+    NuCLIParsingResult_t parse(const uint8_t *in, size_t size, size_t &index, NuCommandLineView_t &parsedCommandLine);
+
+    /**
+     * @brief Notify successfully parsed command line (no heap allocation)
+     *
+     * @note Current implementation executes the zero-allocation callback, if any.
+     *       Otherwise, the command line is converted to NuCommandLine_t
+     *       and passed to onParsingSuccess(NuCommandLine_t&).
+     *
+     * @param[in] commandLine Parsed command line
+     */
+    virtual void onParsingSuccess(NuCommandLineView_t &commandLine);
+#endif
+
     /**
      * @brief Notify parsing error
      *
@@ -187,6 +405,38 @@ private:
     NuCLICommandCallback_t cbUnknown = nullptr;
     std::vector<std::string> vsCommandName;
     std::vector<NuCLICommandCallback_t> vcbCommand;
+    std::vector<bool> vbInline;
+#if __cplusplus >= 201703L
+    NuCLICommandViewCallback_t cbUnknownView = nullptr;
+    std::vector<NuCLICommandViewCallback_t> vcbCommandView;
+    // Reused on every execution to avoid heap allocation
+    NuCommandLineView_t parsedView;
+#ifdef NUS_STATIC_MEMORY
+    NuFixedVector<char, NUS_CLI_MAX_LINE_LENGTH> scratch;
+#else
+    std::vector<char> scratch;
+#endif
+#endif
+    // Line assembly
+#ifdef NUS_STATIC_MEMORY
+    NuFixedVector<char, NUS_CLI_MAX_LINE_LENGTH> lineBuffer;
+#else
+    std::vector<char> lineBuffer;
+#endif
+    size_t lineLength = 0;
+    bool bLineAssembly = false;
+    bool bLineOverflow = false;
+    // Open addressing hash table of indexes to vsCommandName
+    std::vector<size_t> vCommandIndex;
+    bool bCommandIndexDirty = true;
+#ifdef NUS_ENABLE_STATS
+    NuParseStats_t parseStats = {};
+#endif
+
+    static uint32_t hashCommandName(const char *name, size_t length, bool caseSensitive);
+    static bool equalCommandName(const char *a, size_t aLength, const std::string &b, bool caseSensitive);
+    void buildCommandIndex();
+    size_t findCommand(const char *name, size_t length);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,381 @@
+/**
+ * @file NuFrame.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Framed binary messages based on the Nordic UART Service
+ *        with blocking semantics
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <exception>
+#include "NuFrame.hpp"
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+NordicUARTFrame &NuFrame = NordicUARTFrame::getInstance();
+
+// Slot index used to signal a lost connection
+#define NO_SLOT 0xFF
+
+//-----------------------------------------------------------------------------
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+//-----------------------------------------------------------------------------
+
+#define CRC_INITIAL_VALUE 0xFFFF
+
+static const uint16_t crcTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+static uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc)
+{
+    // Note: one nibble at a time, so the table is small
+    while (size-- > 0)
+    {
+        crc = (crc << 4) ^ crcTable[((crc >> 12) ^ (*data >> 4)) & 0x0F];
+        crc = (crc << 4) ^ crcTable[((crc >> 12) ^ (*data & 0x0F)) & 0x0F];
+        data++;
+    }
+    return crc;
+}
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+NordicUARTFrame::NordicUARTFrame() : NordicUARTService()
+{
+    sendLock = xSemaphoreCreateMutexStatic(&sendLockBuffer);
+    txCredit = xSemaphoreCreateBinaryStatic(&txCreditBuffer);
+    createQueue(NUS_DEFAULT_FRAME_QUEUE_SIZE, NUS_DEFAULT_FRAME_MESSAGE_SIZE);
+}
+
+NordicUARTFrame::~NordicUARTFrame()
+{
+    deleteQueue();
+    vSemaphoreDelete(sendLock);
+    vSemaphoreDelete(txCredit);
+}
+
+//-----------------------------------------------------------------------------
+// Message queue
+//-----------------------------------------------------------------------------
+
+bool NordicUARTFrame::createQueue(size_t messageCount, size_t maxMessageSize)
+{
+    currentSlot = NO_SLOT;
+    assemblySlot = NO_SLOT;
+    assemblySize = 0;
+    slotSize = maxMessageSize;
+    pool = (uint8_t *)malloc(messageCount * maxMessageSize);
+    messageSize = (size_t *)malloc(messageCount * sizeof(size_t));
+    messageSeq = (uint16_t *)malloc(messageCount * sizeof(uint16_t));
+    freeSlots = xQueueCreate(messageCount, sizeof(uint8_t));
+    // Note: one more item is needed to signal a lost connection
+    readySlots = xQueueCreate(messageCount + 1, sizeof(uint8_t));
+    if (pool && messageSize && messageSeq && freeSlots && readySlots)
+    {
+        for (uint8_t index = 0; index < messageCount; index++)
+            xQueueSend(freeSlots, &index, 0);
+        return true;
+    }
+    deleteQueue();
+    return false;
+}
+
+void NordicUARTFrame::deleteQueue()
+{
+    if (readySlots)
+        vQueueDelete(readySlots);
+    if (freeSlots)
+        vQueueDelete(freeSlots);
+    free(pool);
+    free(messageSize);
+    free(messageSeq);
+    readySlots = nullptr;
+    freeSlots = nullptr;
+    pool = nullptr;
+    messageSize = nullptr;
+    messageSeq = nullptr;
+    slotSize = 0;
+    currentSlot = NO_SLOT;
+    assemblySlot = NO_SLOT;
+}
+
+void NordicUARTFrame::setRxQueueSize(size_t messageCount, size_t maxMessageSize)
+{
+    if (isConnected())
+        throw std::runtime_error("Unable to set the reception queue size while connected");
+    if ((messageCount == 0) || (messageCount >= NO_SLOT) || (maxMessageSize == 0))
+        throw std::runtime_error("Invalid reception queue size");
+    deleteQueue();
+    if (!createQueue(messageCount, maxMessageSize))
+        throw std::runtime_error("Not enough memory for the reception queue");
+}
+
+void NordicUARTFrame::dropAssembly()
+{
+    if (assemblySlot != NO_SLOT)
+    {
+        xQueueSend(freeSlots, &assemblySlot, 0);
+        assemblySlot = NO_SLOT;
+        overflowCount++;
+    }
+    assemblySize = 0;
+}
+
+bool NordicUARTFrame::getFreeSlot(uint8_t &index)
+{
+    if (!freeSlots)
+        return false;
+    if (xQueueReceive(freeSlots, &index, 0) == pdTRUE)
+        return true;
+    switch (overflowPolicy)
+    {
+    case RX_OVERFLOW_BLOCK:
+    {
+        NUS_STATS(uint64_t blockedSince = NUS_STATS_MICROS());
+        bool result = (xQueueReceive(freeSlots, &index, overflowTimeoutTicks) == pdTRUE);
+        NUS_STATS(stats.rxBlockedMicros += NUS_STATS_MICROS() - blockedSince);
+        return result;
+    }
+    case RX_OVERFLOW_DROP_OLDEST:
+        // Reuse the oldest unread message
+        // Note: it is acknowledged along with the next one (cumulative)
+        while (xQueueReceive(readySlots, &index, 0) == pdTRUE)
+        {
+            if (index != NO_SLOT)
+            {
+                overflowCount++;
+                return true;
+            }
+            // Note: a stale disconnection signal was discarded
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// GATT server events
+//-----------------------------------------------------------------------------
+
+void NordicUARTFrame::onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onConnect(pServer, desc);
+    if (!isConnected(desc->conn_handle))
+        // Rejected
+        return;
+
+    // Start a new session
+    dropAssembly();
+    xSemaphoreTake(sendLock, portMAX_DELAY);
+    txSeq = 0;
+    ackedSeq = 0xFFFF;
+    xSemaphoreGive(sendLock);
+}
+
+void NordicUARTFrame::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onDisconnect(pServer, desc);
+
+    if (!isConnected())
+    {
+        // Awake task at read() after any unread message
+        dropAssembly();
+        uint8_t index = NO_SLOT;
+        if (readySlots)
+            xQueueSend(readySlots, &index, 0);
+        // Awake task at send()
+        xSemaphoreGive(txCredit);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// NordicUARTService implementation
+//-----------------------------------------------------------------------------
+
+void NordicUARTFrame::onReceive(const uint8_t *data, size_t size)
+{
+    // Check header and payload
+    if (size < NUS_FRAME_HEADER_SIZE)
+    {
+        errorCount++;
+        return;
+    }
+    uint8_t type = data[0];
+    uint8_t flags = data[1];
+    uint16_t seq = data[2] | (data[3] << 8);
+    size_t length = data[4] | (data[5] << 8);
+    uint16_t crc = data[6] | (data[7] << 8);
+    const uint8_t *payload = data + NUS_FRAME_HEADER_SIZE;
+    if ((length != size - NUS_FRAME_HEADER_SIZE) ||
+        (crc16(payload, length, crc16(data, 6, CRC_INITIAL_VALUE)) != crc))
+    {
+        errorCount++;
+        // Note: the message being assembled is incomplete
+        dropAssembly();
+        return;
+    }
+
+    if (type == FRAME_TYPE_ACK)
+    {
+        // Ignore acknowledgments of messages not in flight
+        uint16_t acked = ackedSeq;
+        if ((uint16_t)(seq - acked) <= (uint16_t)(txSeq - acked - 1))
+        {
+            ackedSeq = seq;
+            xSemaphoreGive(txCredit);
+        }
+        return;
+    }
+    else if (type != FRAME_TYPE_DATA)
+    {
+        errorCount++;
+        return;
+    }
+
+    // Reassemble
+    if (flags & FRAME_FLAG_FIRST)
+    {
+        dropAssembly();
+        if (!getFreeSlot(assemblySlot))
+        {
+            // Queue overflow: this message is lost
+            assemblySlot = NO_SLOT;
+            overflowCount++;
+            return;
+        }
+        messageSeq[assemblySlot] = seq;
+    }
+    else if ((assemblySlot == NO_SLOT) || (messageSeq[assemblySlot] != seq))
+        // Not part of the message being assembled
+        return;
+
+    if (assemblySize + length > slotSize)
+    {
+        // Message too long
+        dropAssembly();
+        return;
+    }
+    memcpy(pool + (assemblySlot * slotSize) + assemblySize, payload, length);
+    assemblySize += length;
+
+    if (flags & FRAME_FLAG_LAST)
+    {
+        // signal available message
+        messageSize[assemblySlot] = assemblySize;
+        xQueueSend(readySlots, &assemblySlot, 0);
+        assemblySlot = NO_SLOT;
+        assemblySize = 0;
+        NUS_STATS(recordRxLevel(uxQueueMessagesWaiting(readySlots)));
+        signalEvent(NUS_EVENT_RX_DATA);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Reading
+//-----------------------------------------------------------------------------
+
+const uint8_t *NordicUARTFrame::read(size_t &size)
+{
+    release();
+    uint8_t index = NO_SLOT;
+    if (readySlots)
+        xQueueReceive(readySlots, &index, portMAX_DELAY);
+    if (index == NO_SLOT)
+    {
+        // Connection lost
+        size = 0;
+        return nullptr;
+    }
+    currentSlot = index;
+    size = messageSize[index];
+    return pool + (index * slotSize);
+}
+
+void NordicUARTFrame::release()
+{
+    if (currentSlot != NO_SLOT)
+    {
+        uint16_t seq = messageSeq[currentSlot];
+        xQueueSend(freeSlots, &currentSlot, 0);
+        currentSlot = NO_SLOT;
+
+        // Give credit to the peer
+        uint8_t ack[NUS_FRAME_HEADER_SIZE];
+        sendFragment(ack, FRAME_TYPE_ACK, 0, seq, 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Writing
+//-----------------------------------------------------------------------------
+
+bool NordicUARTFrame::sendFragment(uint8_t *fragment, NuFrameType_t type, uint8_t flags, uint16_t seq, size_t length)
+{
+    // Note: the payload is already in place
+    fragment[0] = type;
+    fragment[1] = flags;
+    fragment[2] = seq & 0xFF;
+    fragment[3] = seq >> 8;
+    fragment[4] = length & 0xFF;
+    fragment[5] = length >> 8;
+    uint16_t crc = crc16(fragment + NUS_FRAME_HEADER_SIZE, length, crc16(fragment, 6, CRC_INITIAL_VALUE));
+    fragment[6] = crc & 0xFF;
+    fragment[7] = crc >> 8;
+    size_t size = NUS_FRAME_HEADER_SIZE + length;
+    return (write(fragment, size) == size);
+}
+
+bool NordicUARTFrame::send(const uint8_t *data, size_t size)
+{
+    // Wait for room in the window
+    TickType_t start = xTaskGetTickCount();
+    for (;;)
+    {
+        if (!isConnected())
+            return false;
+        xSemaphoreTake(sendLock, portMAX_DELAY);
+        uint16_t inFlight = txSeq - ackedSeq - 1;
+        if ((txWindow == 0) || (inFlight < txWindow))
+            break;
+        xSemaphoreGive(sendLock);
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if ((elapsed >= ackTimeoutTicks) ||
+            (xSemaphoreTake(txCredit, ackTimeoutTicks - elapsed) == pdFALSE))
+        {
+            // Assume messages in flight were lost, so the session may go on
+            xSemaphoreTake(sendLock, portMAX_DELAY);
+            ackedSeq = txSeq - 1;
+            xSemaphoreGive(sendLock);
+            return false;
+        }
+    }
+
+    // Send fragments
+    // Note: sendLock is held
+    uint16_t seq = txSeq++;
+    uint8_t flags = FRAME_FLAG_FIRST;
+    bool result = true;
+    do
+    {
+        size_t capacity = getFrameSize() - NUS_FRAME_HEADER_SIZE;
+        size_t length = (size > capacity) ? capacity : size;
+        if (length == size)
+            flags |= FRAME_FLAG_LAST;
+        memcpy(txFragment + NUS_FRAME_HEADER_SIZE, data, length);
+        result = sendFragment(txFragment, FRAME_TYPE_DATA, flags, seq, length);
+        data += length;
+        size -= length;
+        flags = 0;
+    } while (result && (size > 0));
+    xSemaphoreGive(sendLock);
+    return result;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file NuFrame.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Framed binary messages based on the Nordic UART Service
+ *        with blocking semantics
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUFRAME_HPP__
+#define __NUFRAME_HPP__
+
+#include "NuS.hpp"
+
+/**
+ * @brief Size in bytes of the header of every fragment
+ *
+ * @note Type (1 byte), flags (1 byte), sequence number (2 bytes),
+ *       payload length (2 bytes) and CRC-16 (2 bytes).
+ *       Multi-byte fields are little-endian.
+ */
+#define NUS_FRAME_HEADER_SIZE 8
+
+/**
+ * @brief Default count of messages held in the reception queue
+ *
+ */
+#define NUS_DEFAULT_FRAME_QUEUE_SIZE 2
+
+/**
+ * @brief Default maximum size in bytes of a single message
+ *
+ */
+#define NUS_DEFAULT_FRAME_MESSAGE_SIZE 2048
+
+/**
+ * @brief Default count of unacknowledged messages in flight
+ *
+ */
+#define NUS_DEFAULT_FRAME_WINDOW 2
+
+/**
+ * @brief Default timeout (in milliseconds) to wait for an acknowledgment
+ *        or for a free slot in the reception queue (RX_OVERFLOW_BLOCK policy)
+ *
+ */
+#define NUS_DEFAULT_FRAME_TIMEOUT 1000
+
+/**
+ * @brief Type of a fragment
+ *
+ */
+typedef enum
+{
+    /** Part of a message */
+    FRAME_TYPE_DATA = 0xD1,
+    /** Acknowledgment of all messages up to the given sequence number */
+    FRAME_TYPE_ACK = 0xA1
+} NuFrameType_t;
+
+/**
+ * @brief Flags of a data fragment
+ *
+ */
+typedef enum
+{
+    /** First fragment of a message */
+    FRAME_FLAG_FIRST = 0x01,
+    /** Last fragment of a message */
+    FRAME_FLAG_LAST = 0x02
+} NuFrameFlags_t;
+
+/**
+ * @brief Message-oriented communications through BLE and Nordic UART Service
+ *
+ * @note Messages larger than a single notification are split into fragments,
+ *       each one with a header. The peer reassembles them into a contiguous
+ *       buffer. Every message has a sequence number and
+ *       every fragment has a CRC-16/CCITT-FALSE checksum.
+ *
+ * @note Flow control: the receiver acknowledges a message when its slot is released.
+ *       The sender waits for an acknowledgment when too many messages are in flight.
+ *       See setTxWindow().
+ *
+ * @note Intended for a single peer.
+ */
+class NordicUARTFrame : public NordicUARTService
+{
+public:
+    // Singleton pattern
+
+    NordicUARTFrame(const NordicUARTFrame &) = delete;
+    void operator=(NordicUARTFrame const &) = delete;
+
+    /**
+     * @brief Get the instance of the BLE framing layer
+     *
+     * @note No need to use. Use `NuFrame` instead.
+     *
+     * @return NordicUARTFrame&
+     */
+    static NordicUARTFrame &getInstance()
+    {
+        static NordicUARTFrame instance;
+        return instance;
+    };
+
+public:
+    // Overriden Methods
+
+    void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+    void onReceive(const uint8_t *data, size_t size) override;
+
+public:
+    /**
+     * @brief Wait for and get a complete incoming message (blocking)
+     *
+     * @note The calling task will get blocked until a message is
+     *       available or the connection is lost.
+     *
+     * @note No data is copied: the returned pointer refers to a
+     *       preallocated slot of the reception queue. That slot is kept
+     *       until release() or read() is called again.
+     *
+     * @param[out] size Size of the message, or zero if the connection was lost.
+     * @return uint8_t* Pointer to the message, or `nullptr` if the connection
+     *                  was lost.
+     */
+    const uint8_t *read(size_t &size);
+
+    /**
+     * @brief Return the last message got from read() to the queue
+     *        and acknowledge it
+     *
+     * @note Call as soon as the message is no longer needed,
+     *       so the peer can send more messages.
+     *       The pointer returned by read() is no longer valid.
+     */
+    void release();
+
+    /**
+     * @brief Send a single message (blocking)
+     *
+     * @note The message is split into fragments that fit the current ATT_MTU.
+     *       Thread-safe: fragments of different messages are not mixed.
+     *
+     * @note Waits for an acknowledgment if too many messages are in flight.
+     *
+     * @param[in] data Pointer to the message
+     * @param[in] size Size of the message. May be zero.
+     * @return true On success
+     * @return false On timeout, failure or lost connection
+     */
+    bool send(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Set the reception queue
+     *
+     * @note Memory is allocated just once, in a single pool.
+     *       Default is NUS_DEFAULT_FRAME_QUEUE_SIZE messages of
+     *       NUS_DEFAULT_FRAME_MESSAGE_SIZE bytes.
+     *
+     * @note Should be called before start(). Unread messages are discarded.
+     *
+     * @param[in] messageCount Count of messages (from 1 to 254).
+     * @param[in] maxMessageSize Maximum size of a single message in bytes.
+     *                           Longer messages are discarded.
+     *
+     * @throws std::runtime_error If called while a peer is connected,
+     *                            invalid parameters or not enough memory.
+     */
+    void setRxQueueSize(size_t messageCount, size_t maxMessageSize = NUS_DEFAULT_FRAME_MESSAGE_SIZE);
+
+    /**
+     * @brief Set the count of unacknowledged messages in flight
+     *
+     * @note Should not exceed the size of the peer's reception queue.
+     *       Default is NUS_DEFAULT_FRAME_WINDOW.
+     *
+     * @param[in] window Count of messages. Zero disables flow control.
+     * @param[in] timeoutMillis Maximum time to wait for an acknowledgment
+     *                          (in milliseconds).
+     */
+    void setTxWindow(uint16_t window, unsigned int timeoutMillis = NUS_DEFAULT_FRAME_TIMEOUT)
+    {
+        ackTimeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+        txWindow = window;
+    };
+
+    /**
+     * @brief Set what to do when a message arrives and the reception queue is full
+     *
+     * @note Default policy is RX_OVERFLOW_DROP_NEWEST, since the peer
+     *       should not exceed the queue size (see setTxWindow()).
+     *
+     * @note RX_OVERFLOW_BLOCK blocks the NimBLE task, unless
+     *       enableRxWorker() is called.
+     *
+     * @param[in] policy Overflow policy
+     * @param[in] timeoutMillis Maximum time to wait for a free slot
+     *                          (in milliseconds) when @p policy is RX_OVERFLOW_BLOCK.
+     *                          Ignored otherwise.
+     */
+    void setRxOverflowPolicy(NuRxOverflowPolicy_t policy, unsigned int timeoutMillis = NUS_DEFAULT_FRAME_TIMEOUT)
+    {
+        overflowTimeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+        overflowPolicy = policy;
+    };
+
+    /**
+     * @brief Get the count of incoming messages lost due to
+     *        queue overflow, excessive size or missing fragments
+     *
+     * @return size_t Count of messages lost since start
+     */
+    size_t getRxOverflowCount()
+    {
+        return overflowCount;
+    };
+
+    /**
+     * @brief Get the count of malformed incoming fragments
+     *
+     * @note Wrong header, length or checksum.
+     *
+     * @return size_t Count of fragments since start
+     */
+    size_t getRxErrorCount()
+    {
+        return errorCount;
+    };
+
+private:
+    // Reception
+    uint8_t *pool = nullptr;
+    size_t *messageSize = nullptr;
+    size_t slotSize = 0;
+    QueueHandle_t freeSlots = nullptr;
+    QueueHandle_t readySlots = nullptr;
+    uint8_t currentSlot;
+    uint8_t assemblySlot;
+    size_t assemblySize = 0;
+    uint16_t *messageSeq = nullptr;
+    NuRxOverflowPolicy_t overflowPolicy = RX_OVERFLOW_DROP_NEWEST;
+    TickType_t overflowTimeoutTicks = pdMS_TO_TICKS(NUS_DEFAULT_FRAME_TIMEOUT);
+    size_t overflowCount = 0;
+    size_t errorCount = 0;
+
+    // Transmission
+    SemaphoreHandle_t sendLock;
+    StaticSemaphore_t sendLockBuffer;
+    SemaphoreHandle_t txCredit;
+    StaticSemaphore_t txCreditBuffer;
+    uint8_t txFragment[NUS_MAX_FRAME_SIZE];
+    uint16_t txSeq = 0;
+    std::atomic<uint16_t> ackedSeq{0xFFFF};
+    uint16_t txWindow = NUS_DEFAULT_FRAME_WINDOW;
+    TickType_t ackTimeoutTicks = pdMS_TO_TICKS(NUS_DEFAULT_FRAME_TIMEOUT);
+
+    bool createQueue(size_t messageCount, size_t maxMessageSize);
+    void deleteQueue();
+    void dropAssembly();
+    bool getFreeSlot(uint8_t &index);
+    bool sendFragment(uint8_t *fragment, NuFrameType_t type, uint8_t flags, uint16_t seq, size_t length);
+    NordicUARTFrame();
+    ~NordicUARTFrame();
+};
+
+/**
+ * @brief Singleton instance of the NordicUARTFrame class
+ *
+ */
+extern NordicUARTFrame &NuFrame;
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file NuLZSS.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Streaming LZSS compression with a small sliding window
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <string.h>
+#include "NuLZSS.hpp"
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#define WINDOW_MASK (NUS_LZSS_WINDOW_SIZE - 1)
+#define HASH(p) ((((p)[0] << 6) ^ ((p)[1] << 3) ^ (p)[2]) & (NUS_LZSS_HASH_SIZE - 1))
+
+// Worst case of a single token, including a new flags byte
+#define MAX_TOKEN_SIZE 3
+
+//-----------------------------------------------------------------------------
+// Encoder
+//-----------------------------------------------------------------------------
+
+void NuLZSSEncoder::reset()
+{
+    memset(history, 0, sizeof(history));
+    memset(hashTable, 0, sizeof(hashTable));
+    position = 0;
+}
+
+void NuLZSSEncoder::append(const uint8_t *in, size_t inSize, size_t index, size_t count)
+{
+    while (count-- > 0)
+    {
+        // Note: hashes need three bytes of input
+        if (index + 2 < inSize)
+            hashTable[HASH(in + index)] = (uint16_t)position;
+        history[position & WINDOW_MASK] = in[index++];
+        position++;
+    }
+}
+
+size_t NuLZSSEncoder::encode(
+    const uint8_t *in,
+    size_t inSize,
+    uint8_t *block,
+    size_t blockCapacity,
+    size_t &blockSize)
+{
+    size_t index = 0;
+    size_t size = 0;
+    size_t flagsIndex = 0;
+    uint8_t flagCount = 8;
+    while ((index < inSize) && (size + MAX_TOKEN_SIZE <= blockCapacity))
+    {
+        if (flagCount == 8)
+        {
+            // New group
+            flagsIndex = size++;
+            block[flagsIndex] = 0;
+            flagCount = 0;
+        }
+
+        // Look for a match at the last position with the same hash
+        // Note: a match may overlap the current position (runs of bytes)
+        size_t length = 0;
+        uint16_t distance = 0;
+        if (index + NUS_LZSS_MIN_MATCH <= inSize)
+        {
+            distance = (uint16_t)position - hashTable[HASH(in + index)];
+            if ((distance > 0) && (distance <= NUS_LZSS_WINDOW_SIZE) && (distance <= position))
+            {
+                size_t maxLength = inSize - index;
+                if (maxLength > NUS_LZSS_MAX_MATCH)
+                    maxLength = NUS_LZSS_MAX_MATCH;
+                uint32_t candidate = position - distance;
+                while ((length < distance) && (length < maxLength) &&
+                       (history[(candidate + length) & WINDOW_MASK] == in[index + length]))
+                    length++;
+                while ((length < maxLength) && (in[index + length - distance] == in[index + length]))
+                    length++;
+            }
+        }
+
+        if (length >= NUS_LZSS_MIN_MATCH)
+        {
+            block[flagsIndex] |= (1 << flagCount);
+            block[size++] = ((length - NUS_LZSS_MIN_MATCH) << 2) | ((distance - 1) >> 8);
+            block[size++] = (distance - 1) & 0xFF;
+        }
+        else
+        {
+            length = 1;
+            block[size++] = in[index];
+        }
+        append(in, inSize, index, length);
+        index += length;
+        flagCount++;
+    }
+    blockSize = size;
+    return index;
+}
+
+//-----------------------------------------------------------------------------
+// Decoder
+//-----------------------------------------------------------------------------
+
+void NuLZSSDecoder::reset()
+{
+    memset(history, 0, sizeof(history));
+    position = 0;
+    flagCount = 0;
+}
+
+size_t NuLZSSDecoder::decode(const uint8_t *&in, size_t &inSize, uint8_t *out, size_t outCapacity)
+{
+    size_t size = 0;
+    while ((inSize > 0) && (size + NUS_LZSS_MAX_MATCH <= outCapacity))
+    {
+        if (flagCount == 0)
+        {
+            // New group
+            flags = *in++;
+            inSize--;
+            flagCount = 8;
+            continue;
+        }
+
+        if (flags & 1)
+        {
+            if (inSize < 2)
+            {
+                // Truncated match
+                in += inSize;
+                inSize = 0;
+                break;
+            }
+            size_t length = (in[0] >> 2) + NUS_LZSS_MIN_MATCH;
+            uint32_t distance = (((in[0] & 0x03) << 8) | in[1]) + 1;
+            in += 2;
+            inSize -= 2;
+            // Note: byte by byte, since the source may overlap the destination
+            for (size_t i = 0; i < length; i++)
+            {
+                uint8_t c = history[(position - distance) & WINDOW_MASK];
+                history[position & WINDOW_MASK] = c;
+                out[size++] = c;
+                position++;
+            }
+        }
+        else
+        {
+            uint8_t c = *in++;
+            inSize--;
+            history[position & WINDOW_MASK] = c;
+            out[size++] = c;
+            position++;
+        }
+        flags >>= 1;
+        flagCount--;
+    }
+    return size;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file NuLZSS.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Streaming LZSS compression with a small sliding window
+ *
+ * @note Compressed data is a sequence of blocks. Every block is a
+ *       sequence of groups: a flags byte followed by up to eight tokens.
+ *       Bit N of the flags byte (LSB first) describes token N:
+ *       - 0: a literal byte.
+ *       - 1: a match (2 bytes): `LLLLLLDD` and `DDDDDDDD`
+ *         (L = length-NUS_LZSS_MIN_MATCH, D = distance-1,
+ *          most significant bit first), meaning a copy of previous bytes.
+ *         Distance is counted back from the current position.
+ *
+ * @note A block ends with its last token and tokens never span blocks,
+ *       but the history (the window) is kept between blocks.
+ *       Thus, each BLE packet is a block. An empty block tells the
+ *       decoder to forget the history, so it can be resynchronized
+ *       with the encoder after a lost block.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_LZSS_HPP__
+#define __NU_LZSS_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Size in bytes of the sliding window (maximum distance of a match)
+ *
+ */
+#define NUS_LZSS_WINDOW_SIZE 1024
+
+/**
+ * @brief Minimum length of a match
+ *
+ */
+#define NUS_LZSS_MIN_MATCH 3
+
+/**
+ * @brief Maximum length of a match
+ *
+ */
+#define NUS_LZSS_MAX_MATCH (NUS_LZSS_MIN_MATCH + 63)
+
+/**
+ * @brief Count of entries in the hash table of the encoder
+ *
+ */
+#define NUS_LZSS_HASH_SIZE 1024
+
+/**
+ * @brief Compressor
+ *
+ * @note About 3 KB of memory. Not thread-safe.
+ */
+class NuLZSSEncoder
+{
+public:
+    NuLZSSEncoder()
+    {
+        reset();
+    };
+
+    /**
+     * @brief Forget the history
+     *
+     * @note Call when the decoder is reset, too.
+     */
+    void reset();
+
+    /**
+     * @brief Compress data into a single block
+     *
+     * @note Input is consumed until the block is full.
+     *       Call again to compress the rest of the input into another block.
+     *
+     * @param[in] in Data to compress
+     * @param[in] inSize Size of @p in in bytes
+     * @param[out] block Buffer to hold the compressed block
+     * @param[in] blockCapacity Size of @p block in bytes (3 or more)
+     * @param[out] blockSize Size of the compressed block in bytes
+     * @return size_t Count of bytes consumed from @p in
+     */
+    size_t encode(
+        const uint8_t *in,
+        size_t inSize,
+        uint8_t *block,
+        size_t blockCapacity,
+        size_t &blockSize);
+
+private:
+    uint8_t history[NUS_LZSS_WINDOW_SIZE];
+    uint16_t hashTable[NUS_LZSS_HASH_SIZE];
+    uint32_t position;
+
+    void append(const uint8_t *in, size_t inSize, size_t index, size_t count);
+};
+
+/**
+ * @brief Decompressor
+ *
+ * @note About 1 KB of memory. Not thread-safe.
+ */
+class NuLZSSDecoder
+{
+public:
+    NuLZSSDecoder()
+    {
+        reset();
+    };
+
+    /**
+     * @brief Forget the history
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Start decoding a new block
+     *
+     */
+    void beginBlock()
+    {
+        flagCount = 0;
+    };
+
+    /**
+     * @brief Decompress (part of) a block
+     *
+     * @note Call beginBlock() first, then call repeatedly
+     *       until @p inSize is zero.
+     *       A truncated match is discarded.
+     *
+     * @param[in,out] in Compressed data. Advanced as it is consumed.
+     * @param[in,out] inSize Size of @p in in bytes. Decreased as it is consumed.
+     * @param[out] out Buffer to hold decompressed data
+     * @param[in] outCapacity Size of @p out in bytes
+     *                        (NUS_LZSS_MAX_MATCH or more)
+     * @return size_t Count of bytes written to @p out
+     */
+    size_t decode(const uint8_t *&in, size_t &inSize, uint8_t *out, size_t outCapacity);
+
+private:
+    uint8_t history[NUS_LZSS_WINDOW_SIZE];
+    uint32_t position;
+    uint8_t flags;
+    uint8_t flagCount;
+};
+
+#endif
@@ -22,51 +22,136 @@ NordicUARTPacket &NuPacket = NordicUARTPacket::getInstance();
 // Constructor / destructor
 //-----------------------------------------------------------------------------
 
+// Slot index used to signal a lost connection
+#define NO_SLOT 0xFF
+
 NordicUARTPacket::NordicUARTPacket() : NordicUARTService()
 {
-    availableByteCount = 0;
-    incomingBuffer = nullptr;
-    dataConsumed = xSemaphoreCreateBinaryStatic(&dataConsumedBuffer);
-    dataAvailable = xSemaphoreCreateBinaryStatic(&dataAvailableBuffer);
-    xSemaphoreGive(dataConsumed);
+    createQueue(NUS_DEFAULT_RX_QUEUE_SIZE);
 }
 
 NordicUARTPacket::~NordicUARTPacket()
 {
-    vSemaphoreDelete(dataConsumed);
-    vSemaphoreDelete(dataAvailable);
+    deleteQueue();
+}
+
+//-----------------------------------------------------------------------------
+// Packet queue
+//-----------------------------------------------------------------------------
+
+bool NordicUARTPacket::createQueue(size_t packetCount)
+{
+    currentSlot = NO_SLOT;
+    slots = (Slot_t *)malloc(packetCount * sizeof(Slot_t));
+    freeSlots = xQueueCreate(packetCount, sizeof(uint8_t));
+    // Note: one more item is needed to signal a lost connection
+    readySlots = xQueueCreate(packetCount + 1, sizeof(uint8_t));
+    if (slots && freeSlots && readySlots)
+    {
+        for (uint8_t index = 0; index < packetCount; index++)
+            xQueueSend(freeSlots, &index, 0);
+        return true;
+    }
+    deleteQueue();
+    return false;
+}
+
+void NordicUARTPacket::deleteQueue()
+{
+    if (readySlots)
+        vQueueDelete(readySlots);
+    if (freeSlots)
+        vQueueDelete(freeSlots);
+    free(slots);
+    readySlots = nullptr;
+    freeSlots = nullptr;
+    slots = nullptr;
+    currentSlot = NO_SLOT;
+}
+
+void NordicUARTPacket::setRxQueueSize(size_t packetCount)
+{
+    if (isConnected())
+        throw std::runtime_error("Unable to set the reception queue size while connected");
+    if ((packetCount == 0) || (packetCount >= NO_SLOT))
+        throw std::runtime_error("Invalid reception queue size");
+    deleteQueue();
+    if (!createQueue(packetCount))
+        throw std::runtime_error("Not enough memory for the reception queue");
+}
+
+bool NordicUARTPacket::getFreeSlot(uint8_t &index)
+{
+    if (!freeSlots)
+        return false;
+    if (xQueueReceive(freeSlots, &index, 0) == pdTRUE)
+        return true;
+    switch (overflowPolicy)
+    {
+    case RX_OVERFLOW_BLOCK:
+    {
+        NUS_STATS(uint64_t blockedSince = NUS_STATS_MICROS());
+        bool result = (xQueueReceive(freeSlots, &index, overflowTimeoutTicks) == pdTRUE);
+        NUS_STATS(stats.rxBlockedMicros += NUS_STATS_MICROS() - blockedSince);
+        return result;
+    }
+    case RX_OVERFLOW_DROP_OLDEST:
+        // Reuse the oldest unread packet
+        while (xQueueReceive(readySlots, &index, 0) == pdTRUE)
+        {
+            if (index != NO_SLOT)
+            {
+                overflowCount++;
+                return true;
+            }
+            // Note: a stale disconnection signal was discarded
+        }
+        return false;
+    default:
+        return false;
+    }
 }
 
 //-----------------------------------------------------------------------------
 // GATT server events
 //-----------------------------------------------------------------------------
 
-void NordicUARTPacket::onDisconnect(NimBLEServer *pServer)
+void NordicUARTPacket::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
 {
-    NordicUARTService::onDisconnect(pServer);
+    NordicUARTService::onDisconnect(pServer, desc);
 
-    // Awake task at read()
-    availableByteCount = 0;
-    incomingBuffer = nullptr;
-    xSemaphoreGive(dataAvailable);
+    // Awake task at read() after any unread packet,
+    // when the last peer is gone
+    uint8_t index = NO_SLOT;
+    if (readySlots && !isConnected())
+        xQueueSend(readySlots, &index, 0);
 };
 
 //-----------------------------------------------------------------------------
 // NordicUARTService implementation
 //-----------------------------------------------------------------------------
 
-void NordicUARTPacket::onWrite(NimBLECharacteristic *pCharacteristic)
+void NordicUARTPacket::onReceive(const uint8_t *data, size_t size)
 {
-    // Wait for previous data to get consumed
-    xSemaphoreTake(dataConsumed, portMAX_DELAY);
+    uint8_t index;
+    if (!getFreeSlot(index))
+    {
+        // Queue overflow: this packet is lost
+        overflowCount++;
+        return;
+    }
 
-    // Hold data until next read
-    incomingPacket = pCharacteristic->getValue();
-    incomingBuffer = incomingPacket.data();
-    availableByteCount = incomingPacket.size();
+    // Hold data until read
+    if (size > NUS_MAX_FRAME_SIZE)
+        size = NUS_MAX_FRAME_SIZE;
+    memcpy(slots[index].data, data, size);
+    slots[index].size = size;
+    slots[index].connHandle = getRxConnHandle();
 
     // signal available data
-    xSemaphoreGive(dataAvailable);
+    xQueueSend(readySlots, &index, 0);
+    NUS_STATS(recordRxLevel(uxQueueMessagesWaiting(readySlots)));
+    signalEvent(NUS_EVENT_RX_DATA);
 }
 
 //-----------------------------------------------------------------------------
@@ -75,8 +160,33 @@ void NordicUARTPacket::onWrite(NimBLECharacteristic *pCharacteristic)
 
 const uint8_t *NordicUARTPacket::read(size_t &size)
 {
-    xSemaphoreGive(dataConsumed);
-    xSemaphoreTake(dataAvailable, portMAX_DELAY);
-    size = availableByteCount;
-    return incomingBuffer;
+    release();
+    uint8_t index = NO_SLOT;
+    if (readySlots)
+        xQueueReceive(readySlots, &index, portMAX_DELAY);
+    if (index == NO_SLOT)
+    {
+        // Connection lost
+        size = 0;
+        return nullptr;
+    }
+    currentSlot = index;
+    size = slots[index].size;
+    return slots[index].data;
+}
+
+uint16_t NordicUARTPacket::getConnHandle()
+{
+    if (currentSlot != NO_SLOT)
+        return slots[currentSlot].connHandle;
+    return BLE_HS_CONN_HANDLE_NONE;
+}
+
+void NordicUARTPacket::release()
+{
+    if (currentSlot != NO_SLOT)
+    {
+        xQueueSend(freeSlots, &currentSlot, 0);
+        currentSlot = NO_SLOT;
+    }
 }
@@ -14,6 +14,18 @@
 
 #include "NuS.hpp"
 
+/**
+ * @brief Default count of packets held in the reception queue
+ *
+ */
+#define NUS_DEFAULT_RX_QUEUE_SIZE 4
+
+/**
+ * @brief Default timeout (in milliseconds) of the RX_OVERFLOW_BLOCK policy
+ *
+ */
+#define NUS_DEFAULT_RX_QUEUE_TIMEOUT 1000
+
 /**
  * @brief Blocking serial communications through BLE and Nordic UART Service
  *
@@ -48,8 +60,8 @@ public:
 public:
     // Overriden Methods
 
-    void onDisconnect(NimBLEServer *pServer) override;
-    void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+    void onReceive(const uint8_t *data, size_t size) override;
 
 public:
     /**
@@ -59,9 +71,11 @@ public:
      *       available or the connection is lost. Just one task
      *       can go beyond read() if more than one exists.
      *
-     * @note You should not perform any time-consuming task between calls.
-     *       Use buffers/queues/etc for that. Follow this advice to increase
-     *       app responsiveness.
+     * @note Incoming packets are queued, so the peer is not blocked
+     *       while you process a packet, unless the queue is full.
+     *       No data is copied: the returned pointer refers to a
+     *       preallocated slot of the queue. That slot is kept
+     *       until release() or read() is called again.
      *
      * @param[out] size Count of incoming bytes,
      *                  or zero if the connection was lost. This is the size of
@@ -73,14 +87,88 @@ public:
      */
     const uint8_t *read(size_t &size);
 
+    /**
+     * @brief Return the last packet got from read() to the queue
+     *
+     * @note Optional. Call as soon as the packet is no longer needed,
+     *       so its slot is available for incoming data earlier.
+     *       The pointer returned by read() is no longer valid.
+     */
+    void release();
+
+    /**
+     * @brief Get the connection handle of the peer that sent
+     *        the last packet got from read()
+     *
+     * @note Use it to reply to that peer alone.
+     *       See NordicUARTService::write(connHandle,data,size).
+     *
+     * @return uint16_t A connection handle or BLE_HS_CONN_HANDLE_NONE
+     *                  if there is no such a packet.
+     */
+    uint16_t getConnHandle();
+
+    /**
+     * @brief Set the count of packets held in the reception queue
+     *
+     * @note A slot of NUS_MAX_FRAME_SIZE bytes is allocated for each packet,
+     *       just once. Default size is NUS_DEFAULT_RX_QUEUE_SIZE packets.
+     *
+     * @note Should be called before start(). Unread packets are discarded.
+     *
+     * @param[in] packetCount Count of packets (from 1 to 254).
+     *
+     * @throws std::runtime_error If called while a peer is connected
+     *                            or not enough memory.
+     */
+    void setRxQueueSize(size_t packetCount);
+
+    /**
+     * @brief Set what to do when the reception queue is full
+     *
+     * @note Default policy is RX_OVERFLOW_BLOCK for
+     *       NUS_DEFAULT_RX_QUEUE_TIMEOUT milliseconds.
+     *
+     * @param[in] policy Overflow policy
+     * @param[in] timeoutMillis Maximum time to wait for a free slot
+     *                          (in milliseconds) when @p policy is RX_OVERFLOW_BLOCK.
+     *                          Ignored otherwise.
+     */
+    void setRxOverflowPolicy(NuRxOverflowPolicy_t policy, unsigned int timeoutMillis = NUS_DEFAULT_RX_QUEUE_TIMEOUT)
+    {
+        overflowTimeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+        overflowPolicy = policy;
+    };
+
+    /**
+     * @brief Get the count of incoming packets lost due to queue overflow
+     *
+     * @return size_t Count of packets lost since start
+     */
+    size_t getRxOverflowCount()
+    {
+        return overflowCount;
+    };
+
 private:
-    SemaphoreHandle_t dataConsumed;
-    StaticSemaphore_t dataConsumedBuffer;
-    SemaphoreHandle_t dataAvailable;
-    StaticSemaphore_t dataAvailableBuffer;
-    NimBLEAttValue incomingPacket;
-    size_t availableByteCount = 0;
-    const uint8_t *incomingBuffer = nullptr;
+    typedef struct
+    {
+        size_t size;
+        uint16_t connHandle;
+        uint8_t data[NUS_MAX_FRAME_SIZE];
+    } Slot_t;
+
+    Slot_t *slots = nullptr;
+    QueueHandle_t freeSlots = nullptr;
+    QueueHandle_t readySlots = nullptr;
+    uint8_t currentSlot;
+    NuRxOverflowPolicy_t overflowPolicy = RX_OVERFLOW_BLOCK;
+    TickType_t overflowTimeoutTicks = pdMS_TO_TICKS(NUS_DEFAULT_RX_QUEUE_TIMEOUT);
+    size_t overflowCount = 0;
+
+    bool createQueue(size_t packetCount);
+    void deleteQueue();
+    bool getFreeSlot(uint8_t &index);
     NordicUARTPacket();
     ~NordicUARTPacket();
 };
@@ -0,0 +1,170 @@
+/**
+ * @file NuRingBuffer.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Lock-free single-producer single-consumer byte ring
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "NuRingBuffer.hpp"
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+NuRingBuffer::~NuRingBuffer()
+{
+    free(buffer);
+}
+
+bool NuRingBuffer::setCapacity(size_t size)
+{
+    // Note: a power of two is required since indexes are free-running
+    // counters that wrap around at SIZE_MAX
+    size_t newSize = 1;
+    while (newSize < size)
+        newSize = newSize << 1;
+
+    free(buffer);
+    head.store(0);
+    tail.store(0);
+    buffer = (uint8_t *)malloc(newSize);
+    bufferSize = buffer ? newSize : 0;
+    return (buffer != nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// Producer side
+//-----------------------------------------------------------------------------
+
+size_t NuRingBuffer::write(const uint8_t *data, size_t size)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t space = bufferSize - (h - t);
+    if (size > space)
+        size = space;
+    if (size > 0)
+    {
+        size_t index = h & (bufferSize - 1);
+        size_t firstCount = bufferSize - index;
+        if (firstCount > size)
+            firstCount = size;
+        memcpy(buffer + index, data, firstCount);
+        memcpy(buffer, data + firstCount, size - firstCount);
+        head.store(h + size, std::memory_order_release);
+    }
+    return size;
+}
+
+size_t NuRingBuffer::discard(size_t size)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t count;
+    do
+    {
+        count = h - t;
+        if (count > size)
+            count = size;
+    } while (!tail.compare_exchange_weak(t, t + count, std::memory_order_acq_rel));
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+// Consumer side
+//-----------------------------------------------------------------------------
+
+size_t NuRingBuffer::read(uint8_t *data, size_t size)
+{
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t count;
+    do
+    {
+        // Note: the copied bytes are valid only if "tail" did not change
+        // in the meantime (the producer may discard them)
+        size_t h = head.load(std::memory_order_acquire);
+        count = h - t;
+        if (count > bufferSize)
+            // "t" is stale, so the copy is not valid, but do not overrun
+            count = bufferSize;
+        if (count > size)
+            count = size;
+        if (count == 0)
+            return 0;
+        size_t index = t & (bufferSize - 1);
+        size_t firstCount = bufferSize - index;
+        if (firstCount > count)
+            firstCount = count;
+        memcpy(data, buffer + index, firstCount);
+        memcpy(data + firstCount, buffer, count - firstCount);
+    } while (!tail.compare_exchange_weak(t, t + count, std::memory_order_acq_rel));
+    return count;
+}
+
+size_t NuRingBuffer::readUntil(uint8_t terminator, uint8_t *data, size_t size, bool &found)
+{
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t count;
+    size_t consumed;
+    do
+    {
+        size_t h = head.load(std::memory_order_acquire);
+        found = false;
+        count = h - t;
+        if (count > bufferSize)
+            // "t" is stale, so the scan is not valid, but do not overrun
+            count = bufferSize;
+        if (count > size)
+            count = size;
+        if (count == 0)
+            return 0;
+
+        // Scan both contiguous runs for the terminator
+        size_t index = t & (bufferSize - 1);
+        size_t firstCount = bufferSize - index;
+        if (firstCount > count)
+            firstCount = count;
+        const uint8_t *match = (const uint8_t *)memchr(buffer + index, terminator, firstCount);
+        if (match)
+        {
+            count = match - (buffer + index);
+            firstCount = count;
+            found = true;
+        }
+        else
+        {
+            match = (const uint8_t *)memchr(buffer, terminator, count - firstCount);
+            if (match)
+            {
+                count = firstCount + (match - buffer);
+                found = true;
+            }
+        }
+        memcpy(data, buffer + index, firstCount);
+        memcpy(data + firstCount, buffer, count - firstCount);
+        consumed = found ? count + 1 : count;
+    } while (!tail.compare_exchange_weak(t, t + consumed, std::memory_order_acq_rel));
+    return count;
+}
+
+int NuRingBuffer::peek() const
+{
+    size_t t = tail.load(std::memory_order_acquire);
+    for (;;)
+    {
+        if (head.load(std::memory_order_acquire) == t)
+            return -1;
+        int result = buffer[t & (bufferSize - 1)];
+        // Note: the byte is valid only if it was not discarded in the meantime
+        std::atomic_thread_fence(std::memory_order_acquire);
+        size_t current = tail.load(std::memory_order_relaxed);
+        if (current == t)
+            return result;
+        t = current;
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file NuRingBuffer.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Lock-free single-producer single-consumer byte ring
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_RING_BUFFER_HPP__
+#define __NU_RING_BUFFER_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Byte ring buffer for a single producer and a single consumer
+ *
+ * @note No locks are used. Just one task (or callback) may write
+ *       and just one task may read at the same time.
+ *
+ * @note The producer is also allowed to discard the oldest bytes
+ *       (see discard()). In such a case, the consumer detects
+ *       the race condition and retries.
+ */
+class NuRingBuffer
+{
+public:
+    NuRingBuffer(){};
+    ~NuRingBuffer();
+
+    NuRingBuffer(const NuRingBuffer &) = delete;
+    void operator=(NuRingBuffer const &) = delete;
+
+    /**
+     * @brief Allocate the buffer
+     *
+     * @note Not thread-safe. Previous contents are discarded.
+     *
+     * @param[in] size Minimum capacity in bytes. Rounded up
+     *                 to a power of two.
+     * @return true On success
+     * @return false Not enough memory. The buffer is left empty, with no capacity.
+     */
+    bool setCapacity(size_t size);
+
+    /**
+     * @brief Get the buffer capacity
+     *
+     * @return size_t Maximum count of stored bytes
+     */
+    size_t capacity() const
+    {
+        return bufferSize;
+    };
+
+    /**
+     * @brief Count of bytes available for reading
+     *
+     * @return size_t Stored bytes
+     */
+    size_t available() const
+    {
+        // Note: "tail" first, since it may move past a stale "head" if the
+        // producer discards in the meantime. Then, "head" may be ahead
+        // of a stale "tail" by more than the capacity.
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t count = head.load(std::memory_order_acquire) - t;
+        return (count > bufferSize) ? bufferSize : count;
+    };
+
+    /**
+     * @brief Count of bytes available for writing
+     *
+     * @return size_t Free space in bytes
+     */
+    size_t freeSpace() const
+    {
+        return bufferSize - available();
+    };
+
+    /**
+     * @brief Store bytes (producer side)
+     *
+     * @param[in] data Bytes to store
+     * @param[in] size Count of bytes to store
+     * @return size_t Count of bytes actually stored, limited by freeSpace().
+     */
+    size_t write(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Drop the oldest bytes (producer side)
+     *
+     * @param[in] size Count of bytes to drop
+     * @return size_t Count of bytes actually dropped
+     */
+    size_t discard(size_t size);
+
+    /**
+     * @brief Retrieve bytes (consumer side)
+     *
+     * @param[out] buffer Where to store the retrieved bytes
+     * @param[in] size Maximum count of bytes to retrieve
+     * @return size_t Count of bytes actually retrieved
+     */
+    size_t read(uint8_t *buffer, size_t size);
+
+    /**
+     * @brief Retrieve bytes up to a terminator (consumer side)
+     *
+     * @note The terminator is retrieved, but not stored in @p buffer.
+     *
+     * @param[in] terminator Byte where to stop
+     * @param[out] buffer Where to store the retrieved bytes
+     * @param[in] size Maximum count of bytes to store
+     * @param[out] found True if the terminator was found
+     * @return size_t Count of bytes stored in @p buffer
+     */
+    size_t readUntil(uint8_t terminator, uint8_t *buffer, size_t size, bool &found);
+
+    /**
+     * @brief Get the next byte without retrieving it (consumer side)
+     *
+     * @return int The next byte or -1 if the buffer is empty.
+     */
+    int peek() const;
+
+private:
+    uint8_t *buffer = nullptr;
+    size_t bufferSize = 0;
+    std::atomic<size_t> head{0}; // total count of written bytes
+    std::atomic<size_t> tail{0}; // total count of read or discarded bytes
+};
+
+#endif
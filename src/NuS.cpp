@@ -14,8 +14,10 @@
 #include <NimBLEDevice.h>
 #include <exception>
 #include <vector>
+#include <new>
 #include <string.h>
 #include <cstdio>
+#include <cstdarg>
 #include "NuS.hpp"
 
 //-----------------------------------------------------------------------------
@@ -25,6 +27,31 @@
 #define NORDIC_UART_SERVICE_UUID "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
 #define RX_CHARACTERISTIC_UUID "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
 #define TX_CHARACTERISTIC_UUID "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define CONTROL_CHARACTERISTIC_UUID "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"
+
+// Flags of incoming packets, stored in the upper bits of the connection handle
+#define RX_FLAG_COMPRESSED 0x8000
+#define RX_FLAG_RESET 0x4000
+#define RX_FLAGS_MASK (RX_FLAG_COMPRESSED | RX_FLAG_RESET)
+
+// Connection profiles.
+// Note: intervals in 1.25 ms units, supervision timeouts in 10 ms units.
+#define THROUGHPUT_MIN_INTERVAL 6
+#define THROUGHPUT_MAX_INTERVAL 12
+#define THROUGHPUT_LATENCY 0
+#define THROUGHPUT_TIMEOUT 400
+#define THROUGHPUT_DATA_LENGTH 251
+#define DEFAULT_DATA_LENGTH 27
+#define LOW_POWER_MIN_INTERVAL 80
+#define LOW_POWER_MAX_INTERVAL 160
+#define LOW_POWER_LATENCY 4
+#define LOW_POWER_TIMEOUT 600
+
+// Advertising intervals (units of 0.625 ms)
+#define FAST_ADVERTISING_MIN_INTERVAL 32
+#define FAST_ADVERTISING_MAX_INTERVAL 48
+#define SLOW_ADVERTISING_MIN_INTERVAL 1636
+#define SLOW_ADVERTISING_MAX_INTERVAL 2056
 
 //-----------------------------------------------------------------------------
 // Constructor / Initialization
@@ -33,11 +60,38 @@
 NordicUARTService::NordicUARTService()
 {
   peerConnected = xSemaphoreCreateBinaryStatic(&peerConnectedBuffer);
+  txLock = xSemaphoreCreateRecursiveMutexStatic(&txLockBuffer);
+  txRoom = xSemaphoreCreateBinaryStatic(&txRoomBuffer);
+  txQueueEmpty = xSemaphoreCreateBinaryStatic(&txQueueEmptyBuffer);
+  events = xEventGroupCreateStatic(&eventsBuffer);
+  flushTimer = xTimerCreateStatic("NuS flush", 1, pdFALSE, this, flushTimerCallback, &flushTimerBuffer);
+  advertisingTimer = xTimerCreateStatic("NuS adv", 1, pdFALSE, this, advertisingTimerCallback, &advertisingTimerBuffer);
+  idleTimer = xTimerCreateStatic("NuS idle", 1, pdFALSE, this, idleTimerCallback, &idleTimerBuffer);
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+  {
+    peers[i].connHandle = BLE_HS_CONN_HANDLE_NONE;
+    peers[i].mtu = 0;
+    peers[i].subscribed = false;
+    peers[i].tuned = false;
+    peers[i].extended = false;
+    peers[i].mtuExchanged = false;
+  }
 }
 
 NordicUARTService::~NordicUARTService()
 {
   vSemaphoreDelete(peerConnected);
+  vSemaphoreDelete(txLock);
+  vSemaphoreDelete(txRoom);
+  vSemaphoreDelete(txQueueEmpty);
+  vEventGroupDelete(events);
+  xTimerDelete(flushTimer, portMAX_DELAY);
+  xTimerDelete(advertisingTimer, portMAX_DELAY);
+  xTimerDelete(idleTimer, portMAX_DELAY);
+  delete pEncoder;
+  delete pDecoder;
+  free(txBlock);
+  free(rxBlock);
 }
 
 void NordicUARTService::init()
@@ -53,11 +107,27 @@ void NordicUARTService::init()
       pTxCharacteristic = pNuS->createCharacteristic(TX_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::NOTIFY);
       if (pTxCharacteristic)
       {
-        NimBLECharacteristic *pRxCharacteristic = pNuS->createCharacteristic(RX_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::WRITE);
+        // Note: onSubscribe() and onStatus() are dispatched to these callbacks only
+        pTxCharacteristic->setCallbacks(this);
+        uint32_t rxProperties = NIMBLE_PROPERTY::WRITE;
+        if (rxWriteWithoutResponse)
+          rxProperties |= NIMBLE_PROPERTY::WRITE_NR;
+        NimBLECharacteristic *pRxCharacteristic = pNuS->createCharacteristic(RX_CHARACTERISTIC_UUID, rxProperties);
         if (pRxCharacteristic)
         {
           pRxCharacteristic->setCallbacks(this);
-          return;
+          if (!pEncoder)
+            return;
+          pControlCharacteristic = pNuS->createCharacteristic(
+              CONTROL_CHARACTERISTIC_UUID,
+              NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
+          if (pControlCharacteristic)
+          {
+            uint8_t value = 0;
+            pControlCharacteristic->setValue(&value, 1);
+            pControlCharacteristic->setCallbacks(this);
+            return;
+          }
         }
       }
     }
@@ -70,15 +140,17 @@ void NordicUARTService::init()
 // Start service
 //-----------------------------------------------------------------------------
 
-void NordicUARTService::start(void)
+void NordicUARTService::start(bool writeWithoutResponse)
 {
   if (!started)
   {
+    if (writeWithoutResponse)
+      rxWriteWithoutResponse = true;
     init();
     pNuS->start();
     started = true;
     if (autoAdvertising)
-      pServer->startAdvertising();
+      restartAdvertising();
   }
 }
 
@@ -88,8 +160,16 @@ void NordicUARTService::start(void)
 
 bool NordicUARTService::isConnected()
 {
-  if (pServer)
-    return (pServer->getConnectedCount() > 0);
+  return connected;
+}
+
+bool NordicUARTService::isConnected(uint16_t connHandle)
+{
+  if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+    return false;
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle == connHandle)
+      return true;
   return false;
 }
 
@@ -101,9 +181,196 @@ bool NordicUARTService::connect(const unsigned int timeoutMillis)
 
 void NordicUARTService::disconnect(void)
 {
-  std::vector<uint16_t> devices = pServer->getPeerDevices();
-  for (uint16_t id : devices)
-    pServer->disconnect(id);
+  // Note: the peers table is used instead of getPeerDevices() (no heap)
+  uint16_t handles[NUS_MAX_CONNECTIONS];
+  size_t count = 0;
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle != BLE_HS_CONN_HANDLE_NONE)
+      handles[count++] = peers[i].connHandle;
+  xSemaphoreGiveRecursive(txLock);
+  if (pServer)
+    for (size_t i = 0; i < count; i++)
+      pServer->disconnect(handles[i]);
+}
+
+void NordicUARTService::disconnect(uint16_t connHandle)
+{
+  if (pServer)
+    pServer->disconnect(connHandle);
+}
+
+void NordicUARTService::setMaxConnections(uint8_t count)
+{
+  if (count == 0)
+    count = 1;
+  maxConnections = (count > NUS_MAX_CONNECTIONS) ? NUS_MAX_CONNECTIONS : count;
+}
+
+//-----------------------------------------------------------------------------
+// Connection profiles
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::setConnectionProfile(NuConnectionProfile_t profile)
+{
+  connectionProfile = profile;
+  if (profile == CONN_PROFILE_THROUGHPUT)
+    // Note: preferred ATT_MTU for future MTU exchanges
+    NimBLEDevice::setMTU(BLE_ATT_MTU_MAX);
+
+  // Note: no lock, so this may be called from the timer task
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    applyConnectionProfile(peers[i]);
+}
+
+void NordicUARTService::applyConnectionProfile(Connection_t &peer)
+{
+  uint16_t connHandle = peer.connHandle;
+  if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+    return;
+
+  // Note: all of these are requests, not commands
+  NuConnectionProfile_t profile = connectionProfile;
+  bool wasTuned = peer.tuned.exchange(profile != CONN_PROFILE_DEFAULT);
+  switch (profile)
+  {
+  case CONN_PROFILE_DEFAULT:
+    if (wasTuned)
+    {
+      // Restore the choice of the peer
+      pServer->updateConnParams(
+          connHandle,
+          peer.peerInterval,
+          peer.peerInterval,
+          peer.peerLatency,
+          peer.peerTimeout);
+      if (peer.extended.exchange(false))
+        pServer->setDataLen(connHandle, DEFAULT_DATA_LENGTH);
+      ble_gap_set_prefered_le_phy(connHandle, BLE_GAP_LE_PHY_ANY_MASK, BLE_GAP_LE_PHY_ANY_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+    }
+    break;
+  case CONN_PROFILE_THROUGHPUT:
+    pServer->updateConnParams(
+        connHandle,
+        THROUGHPUT_MIN_INTERVAL,
+        THROUGHPUT_MAX_INTERVAL,
+        THROUGHPUT_LATENCY,
+        THROUGHPUT_TIMEOUT);
+    if (!peer.extended.exchange(true))
+      pServer->setDataLen(connHandle, THROUGHPUT_DATA_LENGTH);
+    ble_gap_set_prefered_le_phy(connHandle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+    // Note: ATT_MTU may be exchanged just once per connection
+    if (!peer.mtuExchanged.exchange(true))
+      ble_gattc_exchange_mtu(connHandle, nullptr, nullptr);
+    break;
+  case CONN_PROFILE_LOW_POWER:
+    pServer->updateConnParams(
+        connHandle,
+        LOW_POWER_MIN_INTERVAL,
+        LOW_POWER_MAX_INTERVAL,
+        LOW_POWER_LATENCY,
+        LOW_POWER_TIMEOUT);
+    ble_gap_set_prefered_le_phy(connHandle, BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+    break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Idle detection
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::enableIdleDetection(
+    unsigned long idleMillis,
+    NuConnectionProfile_t idleProfile,
+    NuConnectionProfile_t activeProfile)
+{
+  disableIdleDetection();
+  this->idleProfile = idleProfile;
+  this->activeProfile = activeProfile;
+  TickType_t ticks = pdMS_TO_TICKS(idleMillis);
+  idleTicks = (ticks > 0) ? ticks : 1;
+  lastActivityTicks = xTaskGetTickCount();
+  if (connected)
+    xTimerChangePeriod(idleTimer, idleTicks, portMAX_DELAY);
+}
+
+void NordicUARTService::disableIdleDetection()
+{
+  idleTicks = 0;
+  bIdle = false;
+  xTimerStop(idleTimer, portMAX_DELAY);
+}
+
+void NordicUARTService::wakeUp()
+{
+  if (bIdle.exchange(false))
+  {
+    setConnectionProfile(activeProfile);
+    xTimerChangePeriod(idleTimer, idleTicks, 0);
+    signalEvent(NUS_EVENT_ACTIVE);
+  }
+}
+
+void NordicUARTService::idleTimerCallback(TimerHandle_t timer)
+{
+  NordicUARTService *nus = (NordicUARTService *)pvTimerGetTimerID(timer);
+  if (!nus->connected || (nus->idleTicks == 0))
+    return;
+  TickType_t elapsed = xTaskGetTickCount() - nus->lastActivityTicks;
+  if (elapsed < nus->idleTicks)
+    // Some traffic meanwhile: check again later
+    xTimerChangePeriod(timer, nus->idleTicks - elapsed, 0);
+  else if (!nus->bIdle.exchange(true))
+  {
+    nus->setConnectionProfile(nus->idleProfile);
+    nus->signalEvent(NUS_EVENT_IDLE);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Adaptive advertising
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::enableAdaptiveAdvertising(unsigned long fastMillis)
+{
+  TickType_t ticks = pdMS_TO_TICKS(fastMillis);
+  fastAdvertisingTicks = (ticks > 0) ? ticks : 1;
+}
+
+void NordicUARTService::disableAdaptiveAdvertising()
+{
+  fastAdvertisingTicks = 0;
+  xTimerStop(advertisingTimer, portMAX_DELAY);
+}
+
+void NordicUARTService::restartAdvertising()
+{
+  if (fastAdvertisingTicks)
+  {
+    // Note: new intervals take effect when advertising starts
+    NimBLEAdvertising *pAdvertising = pServer->getAdvertising();
+    pAdvertising->stop();
+    pAdvertising->setMinInterval(FAST_ADVERTISING_MIN_INTERVAL);
+    pAdvertising->setMaxInterval(FAST_ADVERTISING_MAX_INTERVAL);
+    pAdvertising->start();
+    xTimerChangePeriod(advertisingTimer, fastAdvertisingTicks, 0);
+  }
+  else
+    pServer->startAdvertising();
+}
+
+void NordicUARTService::advertisingTimerCallback(TimerHandle_t timer)
+{
+  NordicUARTService *nus = (NordicUARTService *)pvTimerGetTimerID(timer);
+  NimBLEAdvertising *pAdvertising = nus->pServer ? nus->pServer->getAdvertising() : nullptr;
+  // Note: advertising stops when a peer connects
+  if (pAdvertising && nus->fastAdvertisingTicks && pAdvertising->isAdvertising())
+  {
+    pAdvertising->stop();
+    pAdvertising->setMinInterval(SLOW_ADVERTISING_MIN_INTERVAL);
+    pAdvertising->setMaxInterval(SLOW_ADVERTISING_MAX_INTERVAL);
+    pAdvertising->start();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -115,24 +382,95 @@ void NordicUARTService::onConnect(NimBLEServer *pServer)
   if (pOtherServerCallbacks)
     pOtherServerCallbacks->onConnect(pServer);
   // Note: onConnect(*pServer, *desc) gets called after this one
-  connected = true;
 }
 
 void NordicUARTService::onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
 {
   if (pOtherServerCallbacks)
     pOtherServerCallbacks->onConnect(pServer, desc);
+
+  // Register this peer
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  // Note: compressed data is meant for a single peer
+  bool isRoom = (getPeerCount() < maxConnections) && !txCompressed;
+  Connection_t *peer = isRoom ? findPeer(BLE_HS_CONN_HANDLE_NONE) : nullptr;
+  if (!peer)
+  {
+    // No room for another peer
+    xSemaphoreGiveRecursive(txLock);
+    pServer->disconnect(desc->conn_handle);
+    return;
+  }
+  // Note: the handle is published last, so readers never see a stale MTU
+  peer->mtu = pServer->getPeerMTU(desc->conn_handle);
+  peer->subscribed = false;
+  peer->peerInterval = desc->conn_itvl;
+  peer->peerLatency = desc->conn_latency;
+  peer->peerTimeout = desc->supervision_timeout;
+  peer->tuned = false;
+  peer->extended = false;
+  peer->mtuExchanged = false;
+  peer->connHandle = desc->conn_handle;
+  bool isFirstPeer = !connected;
+  updateConnectionState();
+  xSemaphoreGiveRecursive(txLock);
+
+  if (idleTicks && isFirstPeer)
+  {
+    // Note: a new peer is expected to send data soon
+    lastActivityTicks = xTaskGetTickCount();
+    bIdle = false;
+    connectionProfile = activeProfile;
+    xTimerChangePeriod(idleTimer, idleTicks, 0);
+  }
+  // Note: other peers keep their settings
+  applyConnectionProfile(*peer);
+
+  // Allow more peers
+  if (autoAdvertising && (pServer->getConnectedCount() < maxConnections))
+    restartAdvertising();
   xSemaphoreGive(peerConnected);
-  connected = true;
+  signalEvent(NUS_EVENT_CONNECTED);
 }
 
 void NordicUARTService::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
 {
   if (pOtherServerCallbacks)
     pOtherServerCallbacks->onDisconnect(pServer, desc);
+
+  // Unregister this peer
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  Connection_t *peer = findPeer(desc->conn_handle);
+  if (!peer)
+  {
+    // A rejected peer
+    bool isRoom = (getPeerCount() < maxConnections);
+    xSemaphoreGiveRecursive(txLock);
+    if (autoAdvertising && isRoom)
+      restartAdvertising();
+    return;
+  }
+  peer->connHandle = BLE_HS_CONN_HANDLE_NONE;
+  updateConnectionState();
+  if (!connected)
+  {
+    // Discard pending data
+    txFrameLength = 0;
+    if (pEncoder)
+      setCompression(false);
+  }
+  xSemaphoreGiveRecursive(txLock);
   if (autoAdvertising)
-    pServer->startAdvertising();
-  connected = false;
+    restartAdvertising();
+
+  // Awake the sender task (if any)
+  xSemaphoreGive(txRoom);
+  if (!connected)
+  {
+    xTimerStop(idleTimer, 0);
+    bIdle = false;
+    signalEvent(NUS_EVENT_DISCONNECTED);
+  }
 }
 
 void NordicUARTService::onDisconnect(NimBLEServer *pServer)
@@ -140,7 +478,56 @@ void NordicUARTService::onDisconnect(NimBLEServer *pServer)
   if (pOtherServerCallbacks)
     pOtherServerCallbacks->onDisconnect(pServer);
   // Note: onDisconnect(*pServer, *desc) gets called after this one
-  connected = false;
+}
+
+void NordicUARTService::onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc)
+{
+  if (pOtherServerCallbacks)
+    pOtherServerCallbacks->onMTUChange(MTU, desc);
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  Connection_t *peer = findPeer(desc->conn_handle);
+  if (peer)
+  {
+    peer->mtu = MTU;
+    peer->mtuExchanged = true;
+  }
+  updateConnectionState();
+  xSemaphoreGiveRecursive(txLock);
+}
+
+// Note: txLock must be held
+void NordicUARTService::updateConnectionState()
+{
+  uint16_t result = 0;
+  bool isAnyPeer = false;
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle != BLE_HS_CONN_HANDLE_NONE)
+    {
+      uint16_t mtu = peers[i].mtu;
+      if ((result == 0) || (mtu < result))
+        result = mtu;
+      isAnyPeer = true;
+    }
+  smallestMTU = result;
+  connected = isAnyPeer;
+}
+
+// Note: txLock must be held
+size_t NordicUARTService::getPeerCount()
+{
+  size_t count = 0;
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle != BLE_HS_CONN_HANDLE_NONE)
+      count++;
+  return count;
+}
+
+NordicUARTService::Connection_t *NordicUARTService::findPeer(uint16_t connHandle)
+{
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle == connHandle)
+      return &peers[i];
+  return nullptr;
 }
 
 void NordicUARTService::setCallbacks(NimBLEServerCallbacks *pServerCallbacks)
@@ -148,36 +535,692 @@ void NordicUARTService::setCallbacks(NimBLEServerCallbacks *pServerCallbacks)
   pOtherServerCallbacks = pServerCallbacks;
 }
 
+//-----------------------------------------------------------------------------
+// Data reception
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::onWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+  // The TX characteristic is not writable
+  if (pCharacteristic == pTxCharacteristic)
+    return;
+  // Note: NimBLE gives a null-terminated, heap-allocated copy of the
+  // characteristic value. This is the only place where such a copy is made,
+  // but it happens for every packet, even if NUS_STATIC_MEMORY is defined.
+  NimBLEAttValue incomingPacket = pCharacteristic->getValue();
+  if (pCharacteristic == pControlCharacteristic)
+  {
+    if (incomingPacket.size() > 0)
+    {
+      bool enable = incomingPacket.data()[0] & NUS_CONTROL_COMPRESSION;
+      xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+      if (enable && (getPeerCount() > 1))
+      {
+        // Rejected: other peers would get compressed data
+        uint8_t value = txCompressed ? NUS_CONTROL_COMPRESSION : 0;
+        pControlCharacteristic->setValue(&value, 1);
+      }
+      else
+        setCompression(enable);
+      xSemaphoreGiveRecursive(txLock);
+    }
+    return;
+  }
+
+  NUS_STATS(stats.rxBytes += incomingPacket.size(); stats.rxPackets++);
+  noteActivity();
+  uint16_t flags = 0;
+  if (rxCompressed)
+  {
+    // Note: the decoder is reset in order with incoming data.
+    // An empty block means the peer reset its history.
+    if (incomingPacket.size() == 0)
+      rxDecoderReset = true;
+    flags = RX_FLAG_COMPRESSED | (rxDecoderReset ? RX_FLAG_RESET : 0);
+    rxDecoderReset = false;
+  }
+  if (rxQueue && ((rxPendingCount > 0) || (flags != 0) || !receiveInline(incomingPacket.data(), incomingPacket.size())))
+  {
+    // Defer to the RX worker task
+    // Note: a little-endian connection handle (and flags) precedes the data
+    size_t size = incomingPacket.size();
+    if (size > NUS_MAX_FRAME_SIZE)
+      size = NUS_MAX_FRAME_SIZE;
+    rxMessage[0] = desc->conn_handle & 0xFF;
+    rxMessage[1] = (desc->conn_handle >> 8) | (flags >> 8);
+    memcpy(rxMessage + 2, incomingPacket.data(), size);
+    rxPendingCount++;
+    if (xMessageBufferSend(rxQueue, rxMessage, size + 2, pdMS_TO_TICKS(NUS_RX_QUEUE_TIMEOUT)) == 0)
+    {
+      rxPendingCount--;
+      rxQueueOverflowCount++;
+    }
+  }
+  else
+  {
+    rxConnHandle = desc->conn_handle;
+    receivePacket(incomingPacket.data(), incomingPacket.size(), flags);
+    rxConnHandle = BLE_HS_CONN_HANDLE_NONE;
+  }
+}
+
+void NordicUARTService::enableRxWorker(
+    size_t queueSize,
+    UBaseType_t priority,
+    uint32_t stackSize,
+    BaseType_t coreID)
+{
+  if (rxQueue)
+    // Already enabled
+    return;
+  // Note: room for a null terminating character
+  rxWorkerFrame = (uint8_t *)malloc(NUS_MAX_FRAME_SIZE + 3);
+  MessageBufferHandle_t queue = xMessageBufferCreate(queueSize);
+  if (rxWorkerFrame && queue)
+  {
+    rxQueue = queue;
+    if (xTaskCreatePinnedToCore(rxWorkerTask, "NuS RX", stackSize, this, priority, nullptr, coreID) == pdPASS)
+      return;
+    rxQueue = nullptr;
+  }
+  if (queue)
+    vMessageBufferDelete(queue);
+  free(rxWorkerFrame);
+  rxWorkerFrame = nullptr;
+  throw std::runtime_error("Unable to create the RX worker");
+}
+
+void NordicUARTService::rxWorkerTask(void *instance)
+{
+  NordicUARTService *nus = (NordicUARTService *)instance;
+  for (;;)
+  {
+    size_t size = xMessageBufferReceive(nus->rxQueue, nus->rxWorkerFrame, NUS_MAX_FRAME_SIZE + 2, portMAX_DELAY);
+    if (size >= 2)
+    {
+      size -= 2;
+      nus->rxWorkerFrame[size + 2] = 0;
+      uint16_t header = nus->rxWorkerFrame[0] | (nus->rxWorkerFrame[1] << 8);
+      nus->rxConnHandle = header & ~RX_FLAGS_MASK;
+      nus->receivePacket(nus->rxWorkerFrame + 2, size, header & RX_FLAGS_MASK);
+      nus->rxConnHandle = BLE_HS_CONN_HANDLE_NONE;
+      nus->rxPendingCount--;
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 // Data transmission
 //-----------------------------------------------------------------------------
 
+size_t NordicUARTService::toFrameSize(uint16_t mtu)
+{
+  if (mtu < BLE_ATT_MTU_DFLT)
+    // Not known yet
+    mtu = BLE_ATT_MTU_DFLT;
+  size_t frameSize = mtu - 3;
+  return (frameSize > NUS_MAX_FRAME_SIZE) ? NUS_MAX_FRAME_SIZE : frameSize;
+}
+
+size_t NordicUARTService::getFrameSize() const
+{
+  return toFrameSize(getMTU());
+}
+
+bool NordicUARTService::notifyFrame(uint16_t connHandle, const uint8_t *data, size_t size, TickType_t timeoutTicks)
+{
+  TickType_t start = xTaskGetTickCount();
+  for (;;)
+  {
+    // Note: the mbuf is consumed by ble_gattc_notify_custom() even on failure
+    int rc;
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, size);
+    if (om)
+      rc = ble_gattc_notify_custom(connHandle, pTxCharacteristic->getHandle(), om);
+    else
+      rc = BLE_HS_ENOMEM;
+    // Note: no room in the host stack or the controller
+    if ((rc != BLE_HS_ENOMEM) && (rc != BLE_HS_EBUSY))
+    {
+      NUS_STATS(if (rc != 0) stats.txFailures++);
+      return (rc == 0);
+    }
+
+    // Congestion: wait for a pending notification to complete, then retry
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if ((elapsed >= timeoutTicks) || !connected)
+    {
+      NUS_STATS(stats.txFailures++);
+      return false;
+    }
+    NUS_STATS(stats.txRetries++);
+    TickType_t waitTicks = timeoutTicks - elapsed;
+    if (waitTicks > pdMS_TO_TICKS(NUS_TX_RETRY_PERIOD))
+      waitTicks = pdMS_TO_TICKS(NUS_TX_RETRY_PERIOD);
+    xSemaphoreTake(txRoom, waitTicks);
+  }
+}
+
+bool NordicUARTService::deliverFrame(uint16_t connHandle, const uint8_t *data, size_t size, TickType_t timeoutTicks)
+{
+  noteActivity();
+  if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+    return notifyFrame(connHandle, data, size, timeoutTicks);
+
+  // Broadcast to all subscribed peers
+  uint16_t targets[NUS_MAX_CONNECTIONS];
+  size_t targetCount = 0;
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if ((peers[i].connHandle != BLE_HS_CONN_HANDLE_NONE) && peers[i].subscribed)
+      targets[targetCount++] = peers[i].connHandle;
+  xSemaphoreGiveRecursive(txLock);
+
+  // Note: nothing is delivered if no peer is subscribed
+  bool result = (targetCount > 0);
+  for (size_t i = 0; i < targetCount; i++)
+    result = notifyFrame(targets[i], data, size, timeoutTicks) && result;
+  return result;
+}
+
+bool NordicUARTService::sendFrame(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+  if (!txCompressed)
+    return transmitFrame(connHandle, data, size);
+
+  // Note: each compressed block fits a single frame
+  size_t frameSize = (connHandle == BLE_HS_CONN_HANDLE_NONE) ? getFrameSize() : toFrameSize(getMTU(connHandle));
+  bool result = true;
+  while (size > 0)
+  {
+    if (txHistoryReset)
+    {
+      // The peer missed a block, so both sides must forget the history.
+      // Note: an empty block tells the peer to do so.
+      pEncoder->reset();
+      if (!transmitFrame(connHandle, txBlock, 0))
+        return false;
+      txHistoryReset = false;
+    }
+    size_t blockSize;
+    size_t count = pEncoder->encode(data, size, txBlock, frameSize, blockSize);
+    if (!transmitFrame(connHandle, txBlock, blockSize))
+    {
+      txHistoryReset = true;
+      result = false;
+    }
+    data += count;
+    size -= count;
+  }
+  return result;
+}
+
+bool NordicUARTService::flushTxFrame()
+{
+  // Note: the pending frame may not fit a single frame
+  // if ATT_MTU was lowered or a peer with a smaller ATT_MTU joined
+  size_t frameSize = getTxBlockSize();
+  bool result = true;
+  for (size_t index = 0; index < txFrameLength; index += frameSize)
+  {
+    size_t count = txFrameLength - index;
+    if (count > frameSize)
+      count = frameSize;
+    result = sendFrame(BLE_HS_CONN_HANDLE_NONE, txFrame + index, count) && result;
+  }
+  txFrameLength = 0;
+  return result;
+}
+
+bool NordicUARTService::transmitFrame(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+  if (txQueue)
+  {
+    // Each message in the TX queue is prefixed with the target connection handle.
+    // Note: txMessage is protected by txLock.
+    txMessage[0] = connHandle & 0xFF;
+    txMessage[1] = connHandle >> 8;
+    memcpy(txMessage + 2, data, size);
+    // Note: counted in advance, since the sender task
+    // may take the frame before xMessageBufferSend() returns
+    txQueuedByteCount += size;
+    NUS_STATS(if (txQueuedByteCount > stats.txQueueHighWater) stats.txQueueHighWater = txQueuedByteCount);
+    if (xMessageBufferSend(txQueue, txMessage, size + 2, txTimeoutTicks) == (size + 2))
+      return true;
+    txQueuedByteCount -= size;
+    return false;
+  }
+  if (deliverFrame(connHandle, data, size, txTimeoutTicks))
+  {
+    txDeliveredByteCount += size;
+    NUS_STATS(stats.txBytes += size; stats.txFrames++);
+    return true;
+  }
+  return false;
+}
+
+size_t NordicUARTService::write(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+  if (!pTxCharacteristic)
+    // Not started
+    return 0;
+
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  Connection_t *peer = findPeer(connHandle);
+  if (!peer || !peer->subscribed)
+  {
+    xSemaphoreGiveRecursive(txLock);
+    return 0;
+  }
+
+  // Keep the order of outgoing data
+  if (txFrameLength > 0)
+  {
+    flushTxFrame();
+  }
+
+  size_t result = size;
+  size_t frameSize = txCompressed ? getTxBlockSize() : toFrameSize(peer->mtu);
+  while (size > 0)
+  {
+    size_t count = (size > frameSize) ? frameSize : size;
+    if (!sendFrame(connHandle, data, count))
+      result -= count;
+    data += count;
+    size -= count;
+  }
+  xSemaphoreGiveRecursive(txLock);
+  return result;
+}
+
 size_t NordicUARTService::write(const uint8_t *data, size_t size)
 {
-  pTxCharacteristic->notify(data, size);
-  return size;
+  if (!pTxCharacteristic)
+    // Not started
+    return 0;
+
+  size_t result = size;
+  const uint8_t *retained = nullptr;
+  size_t retainedCount = 0;
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  size_t frameSize = getTxBlockSize();
+  bool batching = isBatching();
+
+  // Complete the pending frame, if any
+  if (txFrameLength >= frameSize)
+    // ATT_MTU was lowered in the meantime
+    flushTxFrame();
+  else if (txFrameLength > 0)
+  {
+    size_t count = frameSize - txFrameLength;
+    if (count > size)
+      count = size;
+    memcpy(txFrame + txFrameLength, data, count);
+    txFrameLength += count;
+    retained = data;
+    retainedCount = count;
+    data += count;
+    size -= count;
+    if (txFrameLength == frameSize)
+    {
+      if (!sendFrame(BLE_HS_CONN_HANDLE_NONE, txFrame, txFrameLength))
+        result -= count;
+      txFrameLength = 0;
+    }
+  }
+  // Note: at this point (txFrameLength == 0) || (size == 0)
+
+  // Send full frames with no intermediate copy
+  while (size >= frameSize)
+  {
+    if (!sendFrame(BLE_HS_CONN_HANDLE_NONE, data, frameSize))
+      result -= frameSize;
+    data += frameSize;
+    size -= frameSize;
+  }
+
+  // Send or retain the last incomplete frame
+  if (size > 0)
+  {
+    if (coalesceWrites || batching)
+    {
+      memcpy(txFrame, data, size);
+      txFrameLength = size;
+      retained = data;
+      retainedCount = size;
+      // Bound the latency of a new incomplete frame
+      if (!batching && (flushDelayTicks > 0))
+        xTimerChangePeriod(flushTimer, flushDelayTicks, 0);
+    }
+    else if (!sendFrame(BLE_HS_CONN_HANDLE_NONE, data, size))
+      result -= size;
+  }
+
+  if (!batching && (txFrameLength > 0))
+  {
+    // Send a complete line as soon as possible.
+    // Note: data of this task may complete the pending frame of a batching
+    // task, but it is not retained along with it.
+    if ((flushOnNewline && memchr(retained, '\n', retainedCount)) || !coalesceWrites)
+      flushTxFrame();
+  }
+  xSemaphoreGiveRecursive(txLock);
+  return result;
+}
+
+void NordicUARTService::flush()
+{
+  flush(0);
+}
+
+bool NordicUARTService::flush(const unsigned int timeoutMillis)
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  if (txFrameLength > 0)
+  {
+    flushTxFrame();
+  }
+  xSemaphoreGiveRecursive(txLock);
+
+  // Wait for the TX queue to get empty
+  TickType_t timeoutTicks = (timeoutMillis == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMillis);
+  TickType_t start = xTaskGetTickCount();
+  while (txQueue && (txQueuedByteCount > 0))
+  {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= timeoutTicks)
+      return false;
+    xSemaphoreTake(txQueueEmpty, timeoutTicks - elapsed);
+  }
+  return true;
+}
+
+void NordicUARTService::flushTimerCallback(TimerHandle_t timer)
+{
+  NordicUARTService *nus = (NordicUARTService *)pvTimerGetTimerID(timer);
+  // Note: do not block the timer task while another task is writing
+  if (xSemaphoreTakeRecursive(nus->txLock, 0) == pdTRUE)
+  {
+    if ((nus->txFrameLength > 0) && (nus->batchDepth == 0))
+    {
+      nus->flushTxFrame();
+    }
+    xSemaphoreGiveRecursive(nus->txLock);
+  }
+  else
+    // Retry later
+    xTimerStart(timer, 0);
+}
+
+size_t NordicUARTService::getTxFreeSpace()
+{
+  if (!pTxCharacteristic || !connected)
+    return 0;
+
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  size_t frameSize = getFrameSize();
+  size_t result = frameSize;
+  if (txQueue)
+  {
+    // Note: every message takes a length field and a connection handle
+    size_t overhead = sizeof(size_t) + 2;
+    size_t space = xMessageBufferSpacesAvailable(txQueue);
+    size_t rest = space % (frameSize + overhead);
+    result = (space / (frameSize + overhead)) * frameSize;
+    if (rest > overhead)
+      result += rest - overhead;
+  }
+  result = (result > txFrameLength) ? result - txFrameLength : 0;
+  xSemaphoreGiveRecursive(txLock);
+  return result;
+}
+
+void NordicUARTService::disableWriteCoalescing()
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  coalesceWrites = false;
+  if ((txFrameLength > 0) && (batchDepth == 0))
+  {
+    flushTxFrame();
+  }
+  xSemaphoreGiveRecursive(txLock);
+}
+
+bool NordicUARTService::isBatching() const
+{
+  // Note: txLock must be held
+  return (batchDepth > 0) && (batchOwner == xTaskGetCurrentTaskHandle());
+}
+
+void NordicUARTService::beginBatch()
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  if (batchDepth == 0)
+    batchOwner = xTaskGetCurrentTaskHandle();
+  if (batchOwner == xTaskGetCurrentTaskHandle())
+    batchDepth++;
+  // else: another task is batching
+  xSemaphoreGiveRecursive(txLock);
+}
+
+void NordicUARTService::endBatch()
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  if (batchDepth > 0)
+  {
+    if (batchOwner != xTaskGetCurrentTaskHandle())
+    {
+      // Another task is batching
+      xSemaphoreGiveRecursive(txLock);
+      return;
+    }
+    batchDepth--;
+  }
+  if ((batchDepth == 0) && (txFrameLength > 0))
+  {
+    flushTxFrame();
+  }
+  xSemaphoreGiveRecursive(txLock);
+}
+
+//-----------------------------------------------------------------------------
+// Compression
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::enableCompression()
+{
+  if (pEncoder)
+    // Already enabled
+    return;
+  if (started)
+    throw std::runtime_error("Compression must be enabled before start()");
+  pEncoder = new (std::nothrow) NuLZSSEncoder();
+  pDecoder = new (std::nothrow) NuLZSSDecoder();
+  txBlock = (uint8_t *)malloc(NUS_MAX_FRAME_SIZE);
+  // Note: room for a null terminating character
+  rxBlock = (uint8_t *)malloc(NUS_MAX_FRAME_SIZE + 1);
+  if (pEncoder && pDecoder && txBlock && rxBlock)
+    return;
+  delete pEncoder;
+  delete pDecoder;
+  free(txBlock);
+  free(rxBlock);
+  pEncoder = nullptr;
+  pDecoder = nullptr;
+  txBlock = nullptr;
+  rxBlock = nullptr;
+  throw std::runtime_error("Not enough memory for compression");
+}
+
+// Note: txLock must be held
+void NordicUARTService::setCompression(bool enable)
+{
+  if (enable == txCompressed)
+    return;
+
+  // Pending data is sent in the former format
+  if (txFrameLength > 0)
+  {
+    flushTxFrame();
+  }
+  pEncoder->reset();
+  txHistoryReset = false;
+  txCompressed = enable;
+  rxCompressed = enable;
+  rxDecoderReset = enable;
+  uint8_t value = enable ? NUS_CONTROL_COMPRESSION : 0;
+  pControlCharacteristic->setValue(&value, 1);
+}
+
+void NordicUARTService::receivePacket(const uint8_t *data, size_t size, uint16_t flags)
+{
+  if (!(flags & RX_FLAG_COMPRESSED))
+  {
+    onReceive(data, size);
+    return;
+  }
+
+  if (flags & RX_FLAG_RESET)
+    pDecoder->reset();
+  pDecoder->beginBlock();
+  while (size > 0)
+  {
+    size_t count = pDecoder->decode(data, size, rxBlock, NUS_MAX_FRAME_SIZE);
+    if (count > 0)
+    {
+      rxBlock[count] = 0;
+      onReceive(rxBlock, count);
+    }
+  }
+}
+
+size_t NordicUARTService::getTxBlockSize() const
+{
+  // Note: raw data is gathered in larger blocks, since it takes less room once compressed
+  return txCompressed ? NUS_MAX_FRAME_SIZE : getFrameSize();
+}
+
+//-----------------------------------------------------------------------------
+// TX queue
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::enableTxQueue(
+    size_t queueSize,
+    UBaseType_t priority,
+    uint32_t stackSize,
+    BaseType_t coreID)
+{
+  if (txQueue)
+    // Already enabled
+    return;
+  txSenderFrame = (uint8_t *)malloc(NUS_MAX_FRAME_SIZE + 2);
+  MessageBufferHandle_t queue = xMessageBufferCreate(queueSize);
+  if (txSenderFrame && queue)
+  {
+    txQueue = queue;
+    if (xTaskCreatePinnedToCore(txSenderTask, "NuS TX", stackSize, this, priority, nullptr, coreID) == pdPASS)
+      return;
+    txQueue = nullptr;
+  }
+  if (queue)
+    vMessageBufferDelete(queue);
+  free(txSenderFrame);
+  txSenderFrame = nullptr;
+  throw std::runtime_error("Unable to create the TX queue");
+}
+
+void NordicUARTService::txSenderTask(void *instance)
+{
+  NordicUARTService *nus = (NordicUARTService *)instance;
+  // Note: compressed blocks following a lost one can not be decoded,
+  // so they are dropped until the history is reset (an empty block)
+  bool resync = false;
+  for (;;)
+  {
+    size_t size = xMessageBufferReceive(nus->txQueue, nus->txSenderFrame, NUS_MAX_FRAME_SIZE + 2, portMAX_DELAY);
+    if (size >= 2)
+    {
+      // Room in the TX queue
+      nus->signalEvent(NUS_EVENT_TX_READY);
+      uint16_t connHandle = nus->txSenderFrame[0] | (nus->txSenderFrame[1] << 8);
+      size -= 2;
+      if (resync && (!nus->txCompressed || (size == 0)))
+        resync = false;
+      // Retry until sent or the target peer is disconnected
+      if (!resync && nus->deliverFrame(connHandle, nus->txSenderFrame + 2, size, portMAX_DELAY))
+      {
+        nus->txDeliveredByteCount += size;
+        NUS_STATS(nus->stats.txBytes += size; nus->stats.txFrames++);
+      }
+      else if (!resync && nus->txCompressed)
+      {
+        nus->txHistoryReset = true;
+        resync = true;
+      }
+      nus->txQueuedByteCount -= size;
+      if (nus->txQueuedByteCount == 0)
+        xSemaphoreGive(nus->txQueueEmpty);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code)
+{
+  if (pCharacteristic != pTxCharacteristic)
+    return;
+  if (s == NimBLECharacteristicCallbacks::Status::SUCCESS_NOTIFY)
+  {
+    // Room for another notification
+    xSemaphoreGive(txRoom);
+    if (!txQueue)
+      signalEvent(NUS_EVENT_TX_READY);
+  }
+}
+
+void NordicUARTService::onSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue)
+{
+  if (pCharacteristic != pTxCharacteristic)
+    return;
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  Connection_t *peer = findPeer(desc->conn_handle);
+  bool subscribed = peer && (subValue & 0x0001);
+  if (peer)
+    peer->subscribed = subscribed;
+  xSemaphoreGiveRecursive(txLock);
+  if (subscribed)
+    // Outgoing data has a destination now
+    signalEvent(NUS_EVENT_TX_READY);
 }
 
 size_t NordicUARTService::send(const char *str, bool includeNullTerminatingChar)
 {
   size_t size = includeNullTerminatingChar ? strlen(str) + 1 : strlen(str);
-  pTxCharacteristic->notify((uint8_t *)str, size);
-  return size;
+  return write((const uint8_t *)str, size);
 }
 
 size_t NordicUARTService::printf(const char *format, ...)
 {
-  char dummy;
+  size_t writtenBytesCount = 0;
   va_list args;
+
+  // Note: printfBuffer is shared by all tasks
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
   va_start(args, format);
-  int requiredSize = vsnprintf(&dummy, 1, format, args);
+  int requiredSize = vsnprintf(printfBuffer, NUS_PRINTF_BUFFER_SIZE, format, args);
   va_end(args);
-  if (requiredSize == 0)
+  if ((requiredSize >= 0) && (requiredSize < NUS_PRINTF_BUFFER_SIZE))
   {
-    return write((uint8_t *)&dummy, 1);
+    writtenBytesCount = write((uint8_t *)printfBuffer, requiredSize + 1);
   }
   else if (requiredSize > 0)
   {
+#ifdef NUS_STATIC_MEMORY
+    // Too long: truncated
+    writtenBytesCount = write((uint8_t *)printfBuffer, NUS_PRINTF_BUFFER_SIZE);
+#else
+    // Too long: a larger buffer is needed
     char *buffer = (char *)malloc(requiredSize + 1);
     if (buffer)
     {
@@ -185,25 +1228,119 @@ size_t NordicUARTService::printf(const char *format, ...)
       int result = vsnprintf(buffer, requiredSize + 1, format, args);
       va_end(args);
       if ((result >= 0) && (result <= requiredSize))
-      {
-        size_t writtenBytesCount = write((uint8_t *)buffer, result + 1);
-        free(buffer);
-        return writtenBytesCount;
-      }
+        writtenBytesCount = write((uint8_t *)buffer, result + 1);
       free(buffer);
     }
+#endif
   }
+  xSemaphoreGiveRecursive(txLock);
+  return writtenBytesCount;
+}
+
+uint16_t NordicUARTService::getMTU() const
+{
+  // Note: broadcast frames must fit the smallest MTU
+  return smallestMTU;
+}
+
+uint16_t NordicUARTService::getMTU(uint16_t connHandle)
+{
+  if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+    return 0;
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle == connHandle)
+    {
+      uint16_t result = peers[i].mtu;
+      // Note: the entry may have been released meanwhile
+      return (peers[i].connHandle == connHandle) ? result : 0;
+    }
   return 0;
 }
 
-uint16_t NordicUARTService::getMTU() const {
-    if (connected && pServer) {
-        // Assuming there's only one connected peer, or you have a way to identify the correct peer
-        std::vector<uint16_t> peerIds = pServer->getPeerDevices();
-        if (!peerIds.empty()) {
-            // Get the MTU for the first connected peer
-            return pServer->getPeerMTU(peerIds.front());
-        }
+//-----------------------------------------------------------------------------
+// Events
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::signalEvent(NuEvent_t event)
+{
+  // Keep the latest connection state only
+  if (event == NUS_EVENT_CONNECTED)
+    xEventGroupClearBits(events, NUS_EVENT_DISCONNECTED);
+  else if (event == NUS_EVENT_DISCONNECTED)
+    xEventGroupClearBits(events, NUS_EVENT_CONNECTED);
+  else if (event == NUS_EVENT_IDLE)
+    xEventGroupClearBits(events, NUS_EVENT_ACTIVE);
+  else if (event == NUS_EVENT_ACTIVE)
+    xEventGroupClearBits(events, NUS_EVENT_IDLE);
+  xEventGroupSetBits(events, event);
+  if (eventCallback)
+    eventCallback(event);
+}
+
+uint32_t NordicUARTService::waitForEvents(uint32_t eventMask, unsigned long timeoutMillis)
+{
+  if (eventMask == 0)
+    return 0;
+  TickType_t timeoutTicks = (timeoutMillis == ULONG_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMillis);
+  return xEventGroupWaitBits(events, eventMask, pdTRUE, pdFALSE, timeoutTicks) & eventMask;
+}
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+#ifdef NUS_ENABLE_STATS
+
+void NordicUARTService::getStats(NuStats_t &result)
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  result = stats;
+  result.peerCount = 0;
+  for (size_t i = 0; i < NUS_MAX_CONNECTIONS; i++)
+    if (peers[i].connHandle != BLE_HS_CONN_HANDLE_NONE)
+    {
+      result.connHandle[result.peerCount] = peers[i].connHandle;
+      result.mtu[result.peerCount] = peers[i].mtu;
+      result.peerCount++;
     }
-    return 0; // Return 0 or default MTU if not connected
+  xSemaphoreGiveRecursive(txLock);
 }
+
+void NordicUARTService::resetStats()
+{
+  xSemaphoreTakeRecursive(txLock, portMAX_DELAY);
+  stats = {};
+  xSemaphoreGiveRecursive(txLock);
+}
+
+void NordicUARTService::printStats()
+{
+  NuStats_t snapshot;
+  getStats(snapshot);
+  beginBatch();
+  printStat("rxBytes", snapshot.rxBytes);
+  printStat("rxPackets", snapshot.rxPackets);
+  printStat("rxBlockedMicros", snapshot.rxBlockedMicros);
+  printStat("rxBufferHighWater", snapshot.rxBufferHighWater);
+  printStat("txBytes", snapshot.txBytes);
+  printStat("txFrames", snapshot.txFrames);
+  printStat("txRetries", snapshot.txRetries);
+  printStat("txFailures", snapshot.txFailures);
+  printStat("txQueueHighWater", snapshot.txQueueHighWater);
+  for (uint8_t i = 0; i < snapshot.peerCount; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "mtu[%u]", snapshot.connHandle[i]);
+    printStat(name, snapshot.mtu[i]);
+  }
+  endBatch();
+}
+
+void NordicUARTService::printStat(const char *name, unsigned long long value)
+{
+  char line[48];
+  snprintf(line, sizeof(line), "%s=%llu\n", name, value);
+  send(line);
+}
+
+#endif
@@ -16,14 +16,244 @@
 #include <NimBLEServer.h>
 #include <NimBLEService.h>
 #include <NimBLECharacteristic.h>
+#include <freertos/message_buffer.h>
+#include <freertos/event_groups.h>
+#include <freertos/timers.h>
+#include <climits>
 #include <cstring>
+#include <functional>
+#include <string>
+#include <atomic>
+#include "NuSConfig.hpp"
+#include "NuStats.hpp"
+#include "NuLZSS.hpp"
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+ * @brief Maximum count of bytes in a single notification
+ *
+ * @note This is the maximum length of an attribute value.
+ *       Actual frames are limited by ATT_MTU-3.
+ */
+#define NUS_MAX_FRAME_SIZE 512
+
+/**
+ * @brief Size of the per-instance buffer used by printf()
+ *
+ * @note Longer formatted strings require a temporary buffer in the heap,
+ *       or they are truncated if NUS_STATIC_MEMORY is defined.
+ */
+#ifndef NUS_PRINTF_BUFFER_SIZE
+#define NUS_PRINTF_BUFFER_SIZE 128
+#endif
+
+/**
+ * @brief Default timeout (in milliseconds) of outgoing data
+ *
+ * @note Maximum time to wait for room in the BLE stack (no TX queue)
+ *       or in the TX queue.
+ */
+#define NUS_DEFAULT_TX_TIMEOUT 1000
+
+/**
+ * @brief Maximum time (in milliseconds) between retries
+ *        of a notification that failed due to congestion
+ */
+#define NUS_TX_RETRY_PERIOD 20
+
+/**
+ * @brief Default size of the TX queue (in bytes)
+ *
+ */
+#define NUS_DEFAULT_TX_QUEUE_SIZE 4096
+
+/**
+ * @brief Default priority of the TX sender task
+ *
+ */
+#define NUS_DEFAULT_TX_TASK_PRIORITY 5
+
+/**
+ * @brief Default stack size (in bytes) of the TX sender task
+ *
+ */
+#define NUS_DEFAULT_TX_TASK_STACK_SIZE 2560
+
+/**
+ * @brief Default size of the RX worker queue (in bytes)
+ *
+ */
+#define NUS_DEFAULT_RX_QUEUE_SIZE_BYTES 2048
+
+/**
+ * @brief Default priority of the RX worker task
+ *
+ */
+#define NUS_DEFAULT_RX_TASK_PRIORITY 5
+
+/**
+ * @brief Default stack size (in bytes) of the RX worker task
+ *
+ */
+#define NUS_DEFAULT_RX_TASK_STACK_SIZE 4096
+
+/**
+ * @brief Maximum time (in milliseconds) the NimBLE task waits
+ *        for room in the RX worker queue
+ *
+ */
+#define NUS_RX_QUEUE_TIMEOUT 1000
+
+/**
+ * @brief Default duration (in milliseconds) of fast advertising
+ *        before backing off to slow advertising
+ *
+ * @note See NordicUARTService::enableAdaptiveAdvertising()
+ */
+#define NUS_DEFAULT_FAST_ADVERTISING_MILLIS 30000
+
+/**
+ * @brief Default time (in milliseconds) with no incoming or outgoing data
+ *        for a connection to be considered idle
+ *
+ * @note See NordicUARTService::enableIdleDetection()
+ */
+#define NUS_DEFAULT_IDLE_MILLIS 5000
+
+/**
+ * @brief Maximum count of simultaneous peer connections
+ *
+ * @note NimBLE must be configured to allow as many connections
+ *       (CONFIG_BT_NIMBLE_MAX_CONNECTIONS).
+ */
+#ifndef NUS_MAX_CONNECTIONS
+#define NUS_MAX_CONNECTIONS 3
+#endif
+
+/**
+ * @brief What to do with incoming data when the reception buffer is full
+ *
+ */
+typedef enum
+{
+  /** Incoming data that does not fit is lost */
+  RX_OVERFLOW_DROP_NEWEST = 0,
+  /** The oldest unread data is lost to make room for incoming data */
+  RX_OVERFLOW_DROP_OLDEST,
+  /** Wait for room (with a timeout). Then, incoming data that does not fit is lost */
+  RX_OVERFLOW_BLOCK
+} NuRxOverflowPolicy_t;
+
+/**
+ * @brief Link layer settings requested to connected peers
+ *
+ */
+typedef enum
+{
+  /**
+   * Do not request anything. Connection parameters are chosen by the peer.
+   * If another profile was requested, the parameters chosen by the peer
+   * at connection time, the default data length and any PHY are requested back.
+   */
+  CONN_PROFILE_DEFAULT = 0,
+  /** Short connection interval, data length extension, 2M PHY and maximum ATT_MTU */
+  CONN_PROFILE_THROUGHPUT,
+  /** Long connection interval with peripheral latency and 1M PHY */
+  CONN_PROFILE_LOW_POWER
+} NuConnectionProfile_t;
+
+/**
+ * @brief Flags of the control characteristic
+ *
+ * @note The peer writes a single byte to negotiate optional features.
+ *       See NordicUARTService::enableCompression().
+ */
+typedef enum
+{
+  /** LZSS compression of data in both directions. See NuLZSS.hpp. */
+  NUS_CONTROL_COMPRESSION = 0x01
+} NuControlFlags_t;
+
+/**
+ * @brief Events signaled by the Nordic UART Service
+ *
+ * @note Bit flags. See NordicUARTService::waitForEvents().
+ */
+typedef enum
+{
+  /** A peer is connected */
+  NUS_EVENT_CONNECTED = 0x01,
+  /** The last peer is disconnected */
+  NUS_EVENT_DISCONNECTED = 0x02,
+  /** Incoming data is available to read (NuSerial and NuPacket only) */
+  NUS_EVENT_RX_DATA = 0x04,
+  /** There is room for outgoing data: a peer subscribed or a notification completed */
+  NUS_EVENT_TX_READY = 0x08,
+  /** No data was received or sent for a while. See NordicUARTService::enableIdleDetection() */
+  NUS_EVENT_IDLE = 0x10,
+  /** Data was received or sent after an idle period */
+  NUS_EVENT_ACTIVE = 0x20
+} NuEvent_t;
+
+/**
+ * @brief All events
+ *
+ */
+#define NUS_EVENT_ALL 0x3F
+
+/**
+ * @brief Callback for signaled events
+ *
+ * @note Called from the NimBLE task, the TX sender task,
+ *       the timer task or a writing task,
+ *       so it must return as soon as possible.
+ *
+ * @param event A single event
+ */
+typedef std::function<void(NuEvent_t)> NuEventCallback_t;
+
+/**
+ * @brief Runtime statistics of the Nordic UART Service
+ *
+ * @note Available only if NUS_ENABLE_STATS is defined.
+ *       See NordicUARTService::getStats().
+ */
+typedef struct
+{
+  /** Count of incoming bytes */
+  size_t rxBytes;
+  /** Count of incoming packets (BLE writes) */
+  size_t rxPackets;
+  /** Time (in microseconds) spent by the NimBLE task waiting for room in the reception buffer */
+  uint64_t rxBlockedMicros;
+  /** Maximum count of unread bytes (NuSerial) or unread packets (NuPacket) */
+  size_t rxBufferHighWater;
+  /** Count of outgoing bytes delivered to the BLE stack */
+  size_t txBytes;
+  /** Count of outgoing frames delivered to the BLE stack */
+  size_t txFrames;
+  /** Count of notifications retried due to congestion */
+  size_t txRetries;
+  /** Count of notifications that failed (timeout or BLE error) */
+  size_t txFailures;
+  /** Maximum count of bytes in the TX queue */
+  size_t txQueueHighWater;
+  /** Count of connected peers */
+  uint8_t peerCount;
+  /** Connection handle of each connected peer */
+  uint16_t connHandle[NUS_MAX_CONNECTIONS];
+  /** ATT_MTU of each connected peer */
+  uint16_t mtu[NUS_MAX_CONNECTIONS];
+} NuStats_t;
 
 /**
  * @brief Nordic UART Service (NuS) implementation using the NimBLE stack
  *
  * @note This is an abstract class.
- *       Override NimBLECharacteristicCallbacks::onWrite(NimBLECharacteristic *pCharacteristic)
- *       to process incoming data. A singleton pattern is suggested.
+ *       Override onReceive() to process incoming data.
+ *       A singleton pattern is suggested.
  */
 class NordicUARTService : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks
 {
@@ -31,11 +261,25 @@ public:
   /**
    * @brief Check if a peer is connected
    *
+   * @note Safe to call from any task.
+   *
    * @return true When a connection is established
    * @return false When no peer is connected
    */
   bool isConnected();
 
+  /**
+   * @brief Check if a specific peer is connected
+   *
+   * @note Safe to call from any task.
+   *       Peers rejected due to maxConnections are not connected.
+   *
+   * @param[in] connHandle Connection handle of the peer
+   * @return true When @p connHandle is a connected peer
+   * @return false Otherwise
+   */
+  bool isConnected(uint16_t connHandle);
+
   /**
    * @brief Wait for a peer connection or a timeout if set (blocking)
    *
@@ -58,15 +302,183 @@ public:
    */
   void disconnect(void);
 
+  /**
+   * @brief Terminate a single peer connection
+   *
+   * @param[in] connHandle Connection handle of the peer
+   */
+  void disconnect(uint16_t connHandle);
+
+  /**
+   * @brief Set the maximum count of simultaneous peer connections
+   *
+   * @note By default, just one peer is allowed. If more are allowed,
+   *       auto-advertising continues while there is room for another peer.
+   *       Each peer has its own ATT_MTU and subscription state.
+   *       Peers beyond this count are disconnected.
+   *       Should be called before start().
+   *
+   * @param[in] count Count of peers (from 1 to NUS_MAX_CONNECTIONS)
+   */
+  void setMaxConnections(uint8_t count);
+
+  /**
+   * @brief Request link layer settings to connected peers
+   *
+   * @note The profile is requested to current peers and to
+   *       every peer after connection. The peer may reject or
+   *       adjust any request, so this is not guaranteed.
+   *       Default profile is CONN_PROFILE_DEFAULT.
+   *
+   * @note Switch between CONN_PROFILE_THROUGHPUT and CONN_PROFILE_LOW_POWER
+   *       to save power during idle periods.
+   *       Back to CONN_PROFILE_DEFAULT, the connection parameters
+   *       chosen by the peer at connection time are requested again.
+   *       Switching profiles requests new connection parameters and PHY,
+   *       but the data length is requested only when it changes and
+   *       ATT_MTU is exchanged once per connection.
+   *
+   * @note NimBLEDevice::init() **must** be called before.
+   *
+   * @param[in] profile Profile to request
+   */
+  void setConnectionProfile(NuConnectionProfile_t profile);
+
+  /**
+   * @brief Get the profile given to setConnectionProfile()
+   *
+   * @return NuConnectionProfile_t Requested profile
+   */
+  NuConnectionProfile_t getConnectionProfile()
+  {
+    return connectionProfile;
+  };
+
+  /**
+   * @brief Switch connection profiles automatically when traffic is idle
+   *
+   * @note When no data is received or sent for @p idleMillis milliseconds,
+   *       @p idleProfile is requested to connected peers and NUS_EVENT_IDLE
+   *       is signaled. As soon as data is received or sent again,
+   *       @p activeProfile is requested and NUS_EVENT_ACTIVE is signaled.
+   *       The first peer starts with @p activeProfile. Further peers get
+   *       the current profile, so a new peer does not wake up the others.
+   *       See setConnectionProfile().
+   *
+   * @note Pass CONN_PROFILE_DEFAULT as both profiles to get just the events,
+   *       so the application may apply its own policy.
+   *       Note that the switch back to @p activeProfile
+   *       takes some connection intervals.
+   *
+   * @param[in] idleMillis Time with no traffic (in milliseconds)
+   * @param[in] idleProfile Profile to request when idle
+   * @param[in] activeProfile Profile to request when active
+   */
+  void enableIdleDetection(
+      unsigned long idleMillis = NUS_DEFAULT_IDLE_MILLIS,
+      NuConnectionProfile_t idleProfile = CONN_PROFILE_LOW_POWER,
+      NuConnectionProfile_t activeProfile = CONN_PROFILE_THROUGHPUT);
+
+  /**
+   * @brief Stop switching connection profiles when traffic is idle
+   *
+   * @note The current profile is kept.
+   */
+  void disableIdleDetection();
+
+  /**
+   * @brief Check if traffic is idle
+   *
+   * @return true If idle detection is enabled and no data
+   *              was received or sent for a while
+   * @return false Otherwise
+   */
+  bool isIdle() const
+  {
+    return bIdle;
+  };
+
+  /**
+   * @brief Get the connection handle of the peer that sent the data
+   *        being processed at onReceive()
+   *
+   * @return uint16_t A connection handle or BLE_HS_CONN_HANDLE_NONE
+   *                  if called outside onReceive()
+   */
+  uint16_t getRxConnHandle() const
+  {
+    return rxConnHandle;
+  };
+
   /**
    * @brief Send bytes
    *
+   * @note Data is split into frames that fit the current ATT_MTU
+   *       (ATT_MTU-3 bytes each), so nothing is truncated.
+   *       If write coalescing is enabled, small consecutive writes are
+   *       merged into full frames. See enableWriteCoalescing().
+   *
+   * @note If the BLE stack is congested, notifications are retried for
+   *       a limited time. See setTxTimeout().
+   *
+   * @note If the TX queue is enabled, data is sent by a background task,
+   *       so the calling task does not wait for the BLE stack.
+   *       See enableTxQueue().
+   *
+   * @note Data is sent to all connected peers that subscribed to
+   *       TX notifications, using the smallest ATT_MTU among them.
+   *
    * @param[in] data Pointer to bytes to be sent.
    * @param[in] size Count of bytes to be sent.
-   * @return size_t @p size .
+   * @return size_t Count of bytes actually sent, retained by write coalescing
+   *                or stored in the TX queue. Less than @p size in case of timeout.
    */
   size_t write(const uint8_t *data, size_t size);
 
+  /**
+   * @brief Send bytes to a single peer
+   *
+   * @note Same as write(data,size), using the ATT_MTU of the given peer.
+   *       Write coalescing does not apply, but pending data retained by
+   *       write coalescing is sent first.
+   *
+   * @param[in] connHandle Connection handle of the peer
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent.
+   * @return size_t Count of bytes actually sent or stored in the TX queue.
+   *                Zero if @p connHandle is not a subscribed peer.
+   */
+  size_t write(uint16_t connHandle, const uint8_t *data, size_t size);
+
+  /**
+   * @brief Send any pending data retained by write coalescing
+   *        and wait for the TX queue to get empty (if enabled).
+   *
+   * @param[in] timeoutMillis Maximum time to wait (in milliseconds) or
+   *                          zero to disable timeouts and wait forever
+   *
+   * @return true On success
+   * @return false On timeout
+   */
+  bool flush(const unsigned int timeoutMillis);
+
+  /**
+   * @brief Send any pending data with no timeout
+   *
+   * @note Same as flush(0).
+   */
+  void flush();
+
+  /**
+   * @brief Get the count of bytes that can be written without waiting
+   *
+   * @note Room in the TX queue (if enabled) or in a single frame otherwise,
+   *       minus pending data retained by write coalescing.
+   *
+   * @return size_t Count of bytes. Zero if no peer is connected.
+   */
+  size_t getTxFreeSpace();
+
   /**
    * @brief Send a null-terminated string (ANSI encoded)
    *
@@ -85,16 +497,46 @@ public:
    * @param str String to send
    * @return size_t Count of bytes sent.
    */
-  size_t print(std::string str)
+  size_t print(const std::string &str)
   {
     return write((const uint8_t *)str.data(), str.length());
   };
 
+  /**
+   * @brief Send a null-terminated string (any encoding)
+   *
+   * @note The null terminating character is not sent.
+   *
+   * @param str Pointer to null-terminated string to be sent.
+   * @return size_t Count of bytes sent.
+   */
+  size_t print(const char *str)
+  {
+    return send(str);
+  };
+
+#if __cplusplus >= 201703L
+  /**
+   * @brief Send a string view (any encoding)
+   *
+   * @param str String to send
+   * @return size_t Count of bytes sent.
+   */
+  size_t print(std::string_view str)
+  {
+    return write((const uint8_t *)str.data(), str.length());
+  };
+#endif
+
   /**
    * @brief Send a formatted string (ANSI encoded)
    *
    * @note The null terminating character is sent too.
    *
+   * @note No heap is used unless the formatted string
+   *       exceeds NUS_PRINTF_BUFFER_SIZE bytes. If NUS_STATIC_MEMORY
+   *       is defined, such a string is truncated instead.
+   *
    * @param[in] format String that follows the same specifications as format in printf()
    * @param[in] ... Depending on the format string, a sequence of additional arguments,
    *            each containing a value to replace a format specifier in the format string.
@@ -110,9 +552,17 @@ public:
    * @note The service is unavailable if start() is not called.
    *       Do not call start() before initialization is complete in your application.
    *
+   * @note Writes without response let the peer send several packets
+   *       in a single connection event, but there is no flow control
+   *       at the ATT layer. Most clients (nRF Connect, Web Bluetooth) support them.
+   *
+   * @param writeWithoutResponse If true, the RX characteristic accepts
+   *                             writes without response, too.
+   *                             Writes with response are always accepted.
+   *
    * @throws std::runtime_error if the UART service is already created or can not be created
    */
-  void start(void);
+  void start(bool writeWithoutResponse = false);
 
   /**
    * @brief Set your own server callbacks
@@ -147,17 +597,267 @@ public:
     autoAdvertising = false;
   };
 
+  /**
+   * @brief Advertise at fast intervals for a while, then back off
+   *        to slow intervals
+   *
+   * @note Relevant only to automatic advertising. Every time advertising
+   *       is restarted (at start(), after a disconnection or while more peers
+   *       are allowed), fast intervals (20-30 ms) are used for
+   *       @p fastMillis milliseconds, then slow intervals (about 1 s)
+   *       until a peer connects. Peers reconnect quickly, but
+   *       average current stays low if none does.
+   *
+   * @note Should be called before start().
+   *       By default, NimBLE advertising intervals are used.
+   *
+   * @param[in] fastMillis Duration of fast advertising (in milliseconds)
+   */
+  void enableAdaptiveAdvertising(unsigned long fastMillis = NUS_DEFAULT_FAST_ADVERTISING_MILLIS);
+
+  /**
+   * @brief Use NimBLE advertising intervals
+   *
+   * @note Should be called before start().
+   */
+  void disableAdaptiveAdvertising();
+
+  /**
+   * @brief Merge small consecutive writes into full frames
+   *
+   * @note Outgoing bytes are retained until a full frame (ATT_MTU-3 bytes)
+   *       is available, so the count of BLE notifications is reduced.
+   *       Call flush() to send the last incomplete frame, unless
+   *       @p flushDelayMillis or @p flushOnNewline do it for you.
+   *
+   * @note Disabled by default, except for NordicUARTStream (NuSerial).
+   *
+   * @note The delayed flush runs at the FreeRTOS timer task.
+   *       If the TX queue is not enabled, it may wait for the BLE stack.
+   *
+   * @param[in] flushDelayMillis Maximum time (in milliseconds) to
+   *                             retain an incomplete frame.
+   *                             Zero means no limit.
+   * @param[in] flushOnNewline If true, an incomplete frame is sent
+   *                           as soon as a line feed is written.
+   */
+  void enableWriteCoalescing(unsigned int flushDelayMillis = 0, bool flushOnNewline = false)
+  {
+    flushDelayTicks = pdMS_TO_TICKS(flushDelayMillis);
+    this->flushOnNewline = flushOnNewline;
+    coalesceWrites = true;
+  };
+
+  /**
+   * @brief Send every write as soon as possible
+   *
+   * @note This is the default behavior.
+   *       Pending data (if any) is sent before returning.
+   */
+  void disableWriteCoalescing();
+
+  /**
+   * @brief Send outgoing data from a dedicated background task
+   *
+   * @note Outgoing data is stored in a queue, so the calling task
+   *       does not wait for the BLE stack. The background task retries
+   *       every notification until sent while a peer is connected, so
+   *       no data is lost due to BLE stack congestion.
+   *
+   * @note Should be called before start(). Can not be disabled.
+   *       Calling more than once has no effect.
+   *
+   * @param[in] queueSize Size of the TX queue in bytes
+   * @param[in] priority Priority of the background task
+   * @param[in] stackSize Stack size of the background task in bytes
+   * @param[in] coreID CPU core where the background task runs
+   *
+   * @throws std::runtime_error If not enough memory
+   */
+  void enableTxQueue(
+      size_t queueSize = NUS_DEFAULT_TX_QUEUE_SIZE,
+      UBaseType_t priority = NUS_DEFAULT_TX_TASK_PRIORITY,
+      uint32_t stackSize = NUS_DEFAULT_TX_TASK_STACK_SIZE,
+      BaseType_t coreID = tskNO_AFFINITY);
+
+  /**
+   * @brief Process incoming data at a dedicated background task
+   *
+   * @note Incoming data is stored in a queue, so onReceive() is executed
+   *       by the background task instead of the NimBLE task.
+   *       Slow command callbacks (flash access, sensor reads, etc.)
+   *       no longer freeze BLE traffic. Derived classes may still
+   *       process some data at the NimBLE task. See receiveInline().
+   *
+   * @note If the queue is full, the NimBLE task waits for room up to
+   *       NUS_RX_QUEUE_TIMEOUT milliseconds. Then, incoming data is lost.
+   *       See getRxQueueOverflowCount().
+   *
+   * @note Should be called before start(). Can not be disabled.
+   *       Calling more than once has no effect.
+   *
+   * @param[in] queueSize Size of the queue in bytes
+   * @param[in] priority Priority of the background task
+   * @param[in] stackSize Stack size of the background task in bytes
+   * @param[in] coreID CPU core where the background task runs
+   *
+   * @throws std::runtime_error If not enough memory
+   */
+  void enableRxWorker(
+      size_t queueSize = NUS_DEFAULT_RX_QUEUE_SIZE_BYTES,
+      UBaseType_t priority = NUS_DEFAULT_RX_TASK_PRIORITY,
+      uint32_t stackSize = NUS_DEFAULT_RX_TASK_STACK_SIZE,
+      BaseType_t coreID = tskNO_AFFINITY);
+
+  /**
+   * @brief Get the count of incoming packets lost due to a full RX worker queue
+   *
+   * @return size_t Count of packets since start
+   */
+  size_t getRxQueueOverflowCount()
+  {
+    return rxQueueOverflowCount;
+  };
+
+  /**
+   * @brief Allow the peer to negotiate compression of data
+   *
+   * @note A control characteristic (6E400004-B5A3-F393-E0A9-E50E24DCCA9E) is created.
+   *       The peer writes NUS_CONTROL_COMPRESSION there to compress
+   *       data in both directions, or zero to stop compressing. Compression is
+   *       stopped on disconnection. The peer should do this while no data is in flight.
+   *
+   * @note Compression is for a single peer. The request is ignored
+   *       (the control characteristic still reads zero) while other peers are
+   *       connected, and new peers are disconnected while compression is active.
+   *
+   * @note Every notification or write is a block of LZSS-compressed data.
+   *       The history is kept between blocks, so repetitive data
+   *       (for example, JSON telemetry) takes a fraction of the airtime.
+   *       Outgoing data is gathered in blocks of up to NUS_MAX_FRAME_SIZE bytes
+   *       before compression, so enable write coalescing, too.
+   *       Statistics and getTxDeliveredCount() count compressed bytes.
+   *
+   * @note If a block is lost (for example, the TX queue is full), an empty block
+   *       is sent before the next one: both sides forget the history.
+   *       The peer may send an empty block for the same purpose.
+   *
+   * @note About 5 KB of memory are allocated.
+   *       Must be called before start(). Can not be disabled.
+   *       Calling more than once has no effect.
+   *
+   * @throws std::runtime_error If already started or not enough memory
+   */
+  void enableCompression();
+
+  /**
+   * @brief Check if data is being compressed
+   *
+   * @return true If the peer negotiated compression
+   * @return false Otherwise
+   */
+  bool isCompressionActive()
+  {
+    return txCompressed;
+  };
+
+  /**
+   * @brief Set the timeout of outgoing data
+   *
+   * @note Default timeout is NUS_DEFAULT_TX_TIMEOUT milliseconds.
+   *
+   * @param[in] timeoutMillis Maximum time to wait (in milliseconds) for room
+   *                          in the BLE stack or in the TX queue.
+   */
+  void setTxTimeout(const unsigned int timeoutMillis)
+  {
+    txTimeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+  };
+
+  /**
+   * @brief Get the count of outgoing bytes actually delivered to the BLE stack
+   *
+   * @return size_t Count of bytes since start
+   */
+  size_t getTxDeliveredCount()
+  {
+    return txDeliveredByteCount;
+  };
+
+  /**
+   * @brief Wait for any of the given events
+   *
+   * @note Allows the calling task to sleep until there is work to do
+   *       instead of polling. Returned events are cleared.
+   *
+   * @note NUS_EVENT_CONNECTED and NUS_EVENT_DISCONNECTED are
+   *       mutually exclusive. The latest connection state is kept.
+   *
+   * @param[in] eventMask Events to wait for (bitwise OR of NuEvent_t values)
+   * @param[in] timeoutMillis Maximum time to wait in milliseconds.
+   *                          ULONG_MAX means no timeout.
+   * @return uint32_t Signaled events in @p eventMask or zero on timeout
+   */
+  uint32_t waitForEvents(uint32_t eventMask = NUS_EVENT_ALL, unsigned long timeoutMillis = ULONG_MAX);
+
+  /**
+   * @brief Get the FreeRTOS event group where events are signaled
+   *
+   * @note Event bits are NuEvent_t values.
+   *       Useful to wait for other bits in the same group or
+   *       to wait without clearing.
+   *
+   * @return EventGroupHandle_t Event group owned by this object
+   */
+  EventGroupHandle_t getEventGroup()
+  {
+    return events;
+  };
+
+  /**
+   * @brief Set a callback to be called on every signaled event
+   *
+   * @note Should be called before start().
+   *
+   * @param[in] callback Function to call or nullptr to disable
+   */
+  void setEventCallback(NuEventCallback_t callback)
+  {
+    eventCallback = callback;
+  };
+
+#ifdef NUS_ENABLE_STATS
+  /**
+   * @brief Get a snapshot of runtime statistics
+   *
+   * @note Available only if NUS_ENABLE_STATS is defined.
+   *
+   * @param[out] result Statistics since start or since resetStats()
+   */
+  void getStats(NuStats_t &result);
+
+  /**
+   * @brief Reset all runtime statistics to zero
+   *
+   */
+  void resetStats();
+
+  /**
+   * @brief Send runtime statistics to all peers as text
+   *
+   * @note One "name=value" pair per line.
+   *
+   */
+  void printStats();
+#endif
+
 public:
   virtual void onConnect(NimBLEServer *pServer) override;
   virtual void onDisconnect(NimBLEServer *pServer) override;
   virtual void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
   virtual void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
 
-  virtual void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) override
-  {
-    if (pOtherServerCallbacks)
-      pOtherServerCallbacks->onMTUChange(MTU, desc);
-  };
+  virtual void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) override;
 
   virtual uint32_t onPassKeyRequest() override
   {
@@ -179,21 +879,347 @@ public:
     return true;
   };
 
+  /**
+   * @brief Get incoming data from the RX characteristic
+   *
+   * @note Forwards incoming data to onReceive().
+   *       There is no need to override this method.
+   *
+   * @param pCharacteristic RX characteristic
+   * @param desc Connection descriptor of the sender
+   */
+  virtual void onWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc) override;
+  virtual void onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code) override;
+  virtual void onSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue) override;
+
+  /**
+   * @brief Get the smallest ATT_MTU among connected peers
+   *
+   * @note Cached at connection events, so this is cheap and safe
+   *       to call from any task.
+   *
+   * @return uint16_t ATT_MTU or zero if no peer is connected
+   */
   uint16_t getMTU() const;
+
+  /**
+   * @brief Get the ATT_MTU of a single peer
+   *
+   * @note Cached at connection events, so this is cheap and safe
+   *       to call from any task.
+   *
+   * @param[in] connHandle Connection handle of the peer
+   * @return uint16_t ATT_MTU or zero if @p connHandle is not a connected peer
+   */
+  uint16_t getMTU(uint16_t connHandle);
 protected:
   NordicUARTService();
   virtual ~NordicUARTService();
 
+  /**
+   * @brief Accept writes without response at the RX characteristic
+   *
+   * @note Writes with response are always accepted.
+   *       Must be set before start(). See start(writeWithoutResponse).
+   */
+  bool rxWriteWithoutResponse = false;
+
+  /**
+   * @brief Process incoming data
+   *
+   * @note Override this method to implement your own protocol.
+   *       Executed at the NimBLE OS task.
+   *
+   * @param[in] data Pointer to incoming bytes. They are followed by
+   *                 a null terminating character (not counted in @p size),
+   *                 so @p data may be used as a C string.
+   *                 Valid only until this method returns: copy the bytes
+   *                 (not the pointer) for later use.
+   * @param[in] size Count of incoming bytes.
+   */
+  virtual void onReceive(const uint8_t *data, size_t size){};
+
+  /**
+   * @brief Decide if incoming data is processed at the NimBLE task
+   *        despite the RX worker
+   *
+   * @note Called only if the RX worker is enabled and idle,
+   *       so the order of incoming data is kept.
+   *       If true is returned, onReceive() is called at once.
+   *
+   * @param[in] data Pointer to incoming bytes (null-terminated)
+   * @param[in] size Count of incoming bytes
+   * @return true To process @p data at the NimBLE task
+   * @return false To process @p data at the RX worker task (default)
+   */
+  virtual bool receiveInline(const uint8_t *data, size_t size)
+  {
+    return false;
+  };
+
+  /**
+   * @brief Start gathering outgoing data into full frames
+   *
+   * @note Outgoing data written by the calling task is retained
+   *       as if write coalescing was enabled, until endBatch() is called.
+   *       Calls may be nested. Intended to send a whole response
+   *       with the fewest notifications.
+   *
+   * @note Just one task may be batching at the same time.
+   *       Calls from other tasks are ignored and their data is not retained
+   *       (retained data of the batching task is sent along with it).
+   */
+  void beginBatch();
+
+  /**
+   * @brief Send outgoing data gathered since beginBatch()
+   *
+   * @note Does not wait for the TX queue to get empty.
+   *       Ignored if another task is batching.
+   */
+  void endBatch();
+
+  /**
+   * @brief Get the maximum size of a single notification
+   *
+   * @note If write coalescing is disabled, a write of no more
+   *       bytes than this is sent in a single notification.
+   *
+   * @return size_t ATT_MTU-3, but no more than NUS_MAX_FRAME_SIZE.
+   */
+  size_t getFrameSize() const;
+
+  /**
+   * @brief Signal an event to waiting tasks and to the event callback
+   *
+   * @param event Event to signal
+   */
+  void signalEvent(NuEvent_t event);
+
+#ifdef NUS_ENABLE_STATS
+  /**
+   * @brief Runtime statistics. Updated by derived classes, too.
+   *
+   * @note Counters are not atomic, so they are approximate
+   *       if updated from several tasks.
+   */
+  NuStats_t stats = {};
+
+  /**
+   * @brief Update the high-water mark of the reception buffer
+   *
+   * @param level Current count of unread bytes or packets
+   */
+  void recordRxLevel(size_t level)
+  {
+    if (level > stats.rxBufferHighWater)
+      stats.rxBufferHighWater = level;
+  };
+
+  /**
+   * @brief Send a "name=value" line to all peers
+   *
+   * @note Unlike printf(), no null terminating character is sent.
+   *
+   * @param name Name of the statistic
+   * @param value Value of the statistic
+   */
+  void printStat(const char *name, unsigned long long value);
+#endif
+
 private:
   NimBLEServer *pServer = nullptr;
   NimBLEService *pNuS = nullptr;
   NimBLECharacteristic *pTxCharacteristic = nullptr;
+  NimBLECharacteristic *pControlCharacteristic = nullptr;
   NimBLEServerCallbacks *pOtherServerCallbacks = nullptr;
   SemaphoreHandle_t peerConnected;
   StaticSemaphore_t peerConnectedBuffer;
   bool autoAdvertising = true;
+  // Adaptive advertising
+  TickType_t fastAdvertisingTicks = 0;
+  TimerHandle_t advertisingTimer;
+  StaticTimer_t advertisingTimerBuffer;
+  static void advertisingTimerCallback(TimerHandle_t timer);
+  void restartAdvertising();
   bool started = false;
-  bool connected = false;
+  std::atomic<bool> connected{false};
+  EventGroupHandle_t events;
+  StaticEventGroup_t eventsBuffer;
+  NuEventCallback_t eventCallback = nullptr;
+
+  // Connected peers
+  // Note: written at GATT server events while txLock is held,
+  // read from any task with no lock
+  typedef struct
+  {
+    std::atomic<uint16_t> connHandle;
+    std::atomic<uint16_t> mtu;
+    bool subscribed;
+    // Connection parameters chosen by the peer at connection
+    uint16_t peerInterval;
+    uint16_t peerLatency;
+    uint16_t peerTimeout;
+    // A profile other than CONN_PROFILE_DEFAULT was requested
+    std::atomic<bool> tuned;
+    // Data length extension was requested
+    std::atomic<bool> extended;
+    // ATT_MTU was exchanged (allowed once per connection)
+    std::atomic<bool> mtuExchanged;
+  } Connection_t;
+
+  Connection_t peers[NUS_MAX_CONNECTIONS];
+  // Smallest ATT_MTU among connected peers (zero if none)
+  std::atomic<uint16_t> smallestMTU{0};
+  void updateConnectionState();
+  uint8_t maxConnections = 1;
+  std::atomic<NuConnectionProfile_t> connectionProfile{CONN_PROFILE_DEFAULT};
+  void applyConnectionProfile(Connection_t &peer);
+  // Idle detection
+  TickType_t idleTicks = 0;
+  NuConnectionProfile_t idleProfile = CONN_PROFILE_LOW_POWER;
+  NuConnectionProfile_t activeProfile = CONN_PROFILE_THROUGHPUT;
+  std::atomic<TickType_t> lastActivityTicks{0};
+  std::atomic<bool> bIdle{false};
+  TimerHandle_t idleTimer;
+  StaticTimer_t idleTimerBuffer;
+  static void idleTimerCallback(TimerHandle_t timer);
+  void wakeUp();
+
+  /**
+   * @brief Record incoming or outgoing traffic
+   *
+   * @note Cheap: a single atomic store, unless idle.
+   */
+  void noteActivity()
+  {
+    if (idleTicks)
+    {
+      lastActivityTicks = xTaskGetTickCount();
+      if (bIdle)
+        wakeUp();
+    }
+  };
+  uint16_t rxConnHandle = BLE_HS_CONN_HANDLE_NONE;
+
+  /**
+   * @brief Find a connected peer (txLock must be held)
+   *
+   * @param[in] connHandle Connection handle or
+   *                       BLE_HS_CONN_HANDLE_NONE to find a free entry
+   * @return Connection_t* Peer entry or nullptr if not found
+   */
+  Connection_t *findPeer(uint16_t connHandle);
+  size_t getPeerCount();
+
+  // Outgoing data
+  SemaphoreHandle_t txLock;
+  StaticSemaphore_t txLockBuffer;
+  bool coalesceWrites = false;
+  bool flushOnNewline = false;
+  TickType_t flushDelayTicks = 0;
+  TimerHandle_t flushTimer;
+  StaticTimer_t flushTimerBuffer;
+  static void flushTimerCallback(TimerHandle_t timer);
+  unsigned int batchDepth = 0;
+  TaskHandle_t batchOwner = nullptr;
+  bool isBatching() const;
+  uint8_t txFrame[NUS_MAX_FRAME_SIZE];
+  size_t txFrameLength = 0;
+  char printfBuffer[NUS_PRINTF_BUFFER_SIZE];
+  TickType_t txTimeoutTicks = pdMS_TO_TICKS(NUS_DEFAULT_TX_TIMEOUT);
+  SemaphoreHandle_t txRoom;
+  StaticSemaphore_t txRoomBuffer;
+  std::atomic<size_t> txDeliveredByteCount{0};
+
+  // Compression
+  NuLZSSEncoder *pEncoder = nullptr;
+  NuLZSSDecoder *pDecoder = nullptr;
+  uint8_t *txBlock = nullptr;
+  uint8_t *rxBlock = nullptr;
+  std::atomic<bool> txCompressed{false};
+  bool rxCompressed = false;
+  bool rxDecoderReset = false;
+  // A compressed block was lost, so the history must be reset
+  std::atomic<bool> txHistoryReset{false};
+  void setCompression(bool enable);
+  void receivePacket(const uint8_t *data, size_t size, uint16_t flags);
+  size_t getTxBlockSize() const;
+
+  // RX worker
+  MessageBufferHandle_t rxQueue = nullptr;
+  uint8_t *rxWorkerFrame = nullptr;
+  uint8_t rxMessage[NUS_MAX_FRAME_SIZE + 2];
+  std::atomic<size_t> rxPendingCount{0};
+  size_t rxQueueOverflowCount = 0;
+  static void rxWorkerTask(void *instance);
+
+  // TX queue
+  MessageBufferHandle_t txQueue = nullptr;
+  uint8_t *txSenderFrame = nullptr;
+  uint8_t txMessage[NUS_MAX_FRAME_SIZE + 2];
+  std::atomic<size_t> txQueuedByteCount{0};
+  SemaphoreHandle_t txQueueEmpty;
+  StaticSemaphore_t txQueueEmptyBuffer;
+
+  /**
+   * @brief Send a single frame, compressed if negotiated (txLock must be held)
+   *
+   * @param[in] connHandle Target peer or BLE_HS_CONN_HANDLE_NONE to broadcast
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent. No more than getTxBlockSize().
+   * @return true On success (sent or stored in the TX queue)
+   * @return false On timeout or failure
+   */
+  bool sendFrame(uint16_t connHandle, const uint8_t *data, size_t size);
+
+  /**
+   * @brief Send the pending frame, if any (txLock must be held)
+   *
+   * @note Split into several frames if larger than getTxBlockSize().
+   * @return true On success or nothing pending
+   * @return false On timeout or failure
+   */
+  bool flushTxFrame();
+
+  /**
+   * @brief Send a single frame as is (txLock must be held)
+   *
+   * @param[in] connHandle Target peer or BLE_HS_CONN_HANDLE_NONE to broadcast
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent. No more than the frame size.
+   * @return true On success (sent or stored in the TX queue)
+   * @return false On timeout or failure
+   */
+  bool transmitFrame(uint16_t connHandle, const uint8_t *data, size_t size);
+
+  /**
+   * @brief Deliver a single frame to the BLE stack
+   *
+   * @param[in] connHandle Target peer or BLE_HS_CONN_HANDLE_NONE to broadcast
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent.
+   * @param[in] timeoutTicks Maximum time to retry
+   * @return true On success (every subscribed peer got the frame)
+   * @return false On timeout, failure or no subscribed peer
+   */
+  bool deliverFrame(uint16_t connHandle, const uint8_t *data, size_t size, TickType_t timeoutTicks);
+
+  /**
+   * @brief Notify a single frame to a single peer, retrying in case of congestion
+   *
+   * @param[in] connHandle Target peer
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent.
+   * @param[in] timeoutTicks Maximum time to retry
+   * @return true On success
+   * @return false On timeout or failure
+   */
+  bool notifyFrame(uint16_t connHandle, const uint8_t *data, size_t size, TickType_t timeoutTicks);
+
+  static size_t toFrameSize(uint16_t mtu);
+
+  static void txSenderTask(void *instance);
 
   /**
    * @brief Create the NuS service in a new GATT server
@@ -0,0 +1,207 @@
+/**
+ * @file NuSConfig.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Compile-time configuration of memory usage
+ *
+ * @note Define NUS_STATIC_MEMORY globally (as a build flag) to get
+ *       bounded memory usage: buffers owned by this library are
+ *       fixed-capacity and statically allocated, with sizes set by
+ *       the macros below. Such macros may be defined as build flags, too.
+ *       Every source file must see the same configuration.
+ *
+ * @note Even so, buffers and queues explicitly sized by the application
+ *       (for example, setRxBufferSize() or enableTxQueue()) are allocated
+ *       once, at the time of the call.
+ *
+ * @note Not heap-free on the reception path: NimBLE 1.4 gives a heap-allocated
+ *       copy of every incoming packet (NimBLEAttValue), and shell callbacks
+ *       taking a NuCommandLine_t build a std::string for every argument.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUS_CONFIG_HPP__
+#define __NUS_CONFIG_HPP__
+
+#include <stddef.h>
+#include <stdexcept>
+
+#ifdef NUS_STATIC_MEMORY
+
+/**
+ * @brief Maximum size of the AT parser workspace (NuATCommandParser::setBufferSize())
+ *
+ */
+#ifndef AT_STATIC_BUFFER_SIZE
+#define AT_STATIC_BUFFER_SIZE 42
+#endif
+
+/**
+ * @brief Maximum length of an AT command line when line assembly is enabled
+ *
+ */
+#ifndef AT_STATIC_MAX_LINE_LENGTH
+#define AT_STATIC_MAX_LINE_LENGTH 256
+#endif
+
+/**
+ * @brief Size of the buffer holding the retained responses of a single AT command
+ *
+ * @note See NuATCommandParser::beginAsync(). Responses not fitting are discarded.
+ */
+#ifndef AT_STATIC_RESPONSE_SIZE
+#define AT_STATIC_RESPONSE_SIZE 128
+#endif
+
+/**
+ * @brief Maximum count of strings in a shell command line
+ *
+ */
+#ifndef NUS_CLI_MAX_ARGS
+#define NUS_CLI_MAX_ARGS 16
+#endif
+
+/**
+ * @brief Maximum length of a shell command line
+ *
+ */
+#ifndef NUS_CLI_MAX_LINE_LENGTH
+#define NUS_CLI_MAX_LINE_LENGTH 256
+#endif
+
+#endif
+
+/**
+ * @brief Fixed-capacity vector with no heap allocation
+ *
+ * @note A subset of std::vector, so code using the common members
+ *       (size(), operator[], range-based for loops, etc.) works
+ *       with both. Items beyond @p N are discarded.
+ *       Intended for trivially copyable types.
+ *
+ * @tparam T Item type
+ * @tparam N Capacity
+ */
+template <typename T, size_t N>
+class NuFixedVector
+{
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    size_t size() const
+    {
+        return count;
+    };
+
+    bool empty() const
+    {
+        return (count == 0);
+    };
+
+    static constexpr size_t max_size()
+    {
+        return N;
+    };
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    };
+
+    void clear()
+    {
+        count = 0;
+    };
+
+    void push_back(const T &item)
+    {
+        if (count < N)
+            items[count++] = item;
+    };
+
+    void resize(size_t newSize)
+    {
+        count = (newSize < N) ? newSize : N;
+    };
+
+    void reserve(size_t newCapacity) {};
+    void shrink_to_fit() {};
+
+    iterator insert(iterator position, const T *first, const T *last)
+    {
+        size_t index = position - items;
+        size_t length = last - first;
+        if (length > N - count)
+            return position;
+        for (size_t i = count; i > index; i--)
+            items[i - 1 + length] = items[i - 1];
+        for (size_t i = 0; i < length; i++)
+            items[index + i] = first[i];
+        count += length;
+        return position;
+    };
+
+    T &operator[](size_t index)
+    {
+        return items[index];
+    };
+
+    const T &operator[](size_t index) const
+    {
+        return items[index];
+    };
+
+    T &at(size_t index)
+    {
+        if (index >= count)
+            throw std::out_of_range("NuFixedVector");
+        return items[index];
+    };
+
+    const T &at(size_t index) const
+    {
+        if (index >= count)
+            throw std::out_of_range("NuFixedVector");
+        return items[index];
+    };
+
+    T *data()
+    {
+        return items;
+    };
+
+    const T *data() const
+    {
+        return items;
+    };
+
+    iterator begin()
+    {
+        return items;
+    };
+
+    iterator end()
+    {
+        return items + count;
+    };
+
+    const_iterator begin() const
+    {
+        return items;
+    };
+
+    const_iterator end() const
+    {
+        return items + count;
+    };
+
+private:
+    T items[N];
+    size_t count = 0;
+};
+
+#endif
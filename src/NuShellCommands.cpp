@@ -20,11 +20,52 @@ NuShellCommandProcessor &NuShellCommands = NuShellCommandProcessor::getInstance(
 // NordicUARTService implementation
 //-----------------------------------------------------------------------------
 
-void NuShellCommandProcessor::onWrite(NimBLECharacteristic *pCharacteristic)
+void NuShellCommandProcessor::onReceive(const uint8_t *data, size_t size)
 {
-    // Incoming data
-    NimBLEAttValue incomingPacket = pCharacteristic->getValue();
+    // Parse and execute.
+    // All responses are gathered and sent in as few notifications as possible.
+    if (lineAssemblyResetPending.exchange(false))
+        resetLineAssembly();
+    beginBatch();
+    executeData(data, size);
+    endBatch();
+}
+
+bool NuShellCommandProcessor::receiveInline(const uint8_t *data, size_t size)
+{
+    // Note: a chunk of data may not be a whole command line
+    // if line assembly is enabled, and the line buffer
+    // must be used from a single task
+    return !isLineAssemblyEnabled() && isInline(data, size);
+}
 
-    // Parse and execute
-    execute((const uint8_t *)incomingPacket.data(), incomingPacket.size());
+void NuShellCommandProcessor::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onDisconnect(pServer, desc);
+    if (!isConnected())
+    {
+        // Note: incoming data may be parsed at another task (see enableRxWorker()),
+        // so the line assembly buffer is reset there
+        lineAssemblyResetPending = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+#ifdef NUS_ENABLE_STATS
+void NuShellCommandProcessor::enableStatsCommand(const std::string commandName)
+{
+    on(commandName, [this](NuCommandLine_t &commandLine)
+       {
+           const NuParseStats_t &parseStats = getParseStats();
+           beginBatch();
+           printStats();
+           printStat("parseCount", parseStats.count);
+           printStat("parseTotalMicros", parseStats.totalMicros);
+           printStat("parseMaxMicros", parseStats.maxMicros);
+           endBatch();
+       });
 }
+#endif
@@ -40,9 +40,25 @@ public:
 
 public:
     // Overriden Methods
-    virtual void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    virtual void onReceive(const uint8_t *data, size_t size) override;
+    virtual bool receiveInline(const uint8_t *data, size_t size) override;
+    virtual void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+
+#ifdef NUS_ENABLE_STATS
+    /**
+     * @brief Add a built-in shell command that prints runtime statistics
+     *
+     * @note Available only if NUS_ENABLE_STATS is defined.
+     *       Prints service statistics (see NordicUARTService::printStats())
+     *       and parser statistics.
+     *
+     * @param commandName Name of the built-in command
+     */
+    void enableStatsCommand(const std::string commandName = "nustats");
+#endif
 
 private:
+    std::atomic<bool> lineAssemblyResetPending{false};
     NuShellCommandProcessor(){};
 };
 
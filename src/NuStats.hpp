@@ -0,0 +1,75 @@
+/**
+ * @file NuStats.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-14
+ * @brief Optional runtime statistics
+ *
+ * @note Statistics are compiled out unless NUS_ENABLE_STATS is defined.
+ *       Define it globally (as a build flag), so every source file
+ *       sees the same class layout.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_STATS_HPP__
+#define __NU_STATS_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef NUS_ENABLE_STATS
+
+#ifndef NUS_STATS_MICROS
+#include <esp_timer.h>
+/**
+ * @brief Current time in microseconds, used for instrumentation
+ *
+ */
+#define NUS_STATS_MICROS() ((uint64_t)esp_timer_get_time())
+#endif
+
+/**
+ * @brief Execute a statement only if statistics are enabled
+ *
+ */
+#define NUS_STATS(statement) statement
+
+#else
+
+#define NUS_STATS(statement)
+
+#endif
+
+/**
+ * @brief Parsing and dispatching statistics of a command parser
+ *
+ */
+typedef struct
+{
+    /** Count of parsed chunks of incoming data */
+    size_t count;
+    /** Total parse and dispatch time in microseconds */
+    uint64_t totalMicros;
+    /** Maximum parse and dispatch time in microseconds */
+    uint32_t maxMicros;
+} NuParseStats_t;
+
+#ifdef NUS_ENABLE_STATS
+/**
+ * @brief Record the parse and dispatch time of a single chunk
+ *
+ * @param stats Statistics to update
+ * @param startMicros Time when parsing started
+ */
+inline void NuRecordParseTime(NuParseStats_t &stats, uint64_t startMicros)
+{
+    uint32_t elapsed = (uint32_t)(NUS_STATS_MICROS() - startMicros);
+    stats.count++;
+    stats.totalMicros += elapsed;
+    if (elapsed > stats.maxMicros)
+        stats.maxMicros = elapsed;
+}
+#endif
+
+#endif
@@ -8,6 +8,7 @@
  *
  */
 
+#include <exception>
 #include "NuStream.hpp"
 
 //-----------------------------------------------------------------------------
@@ -16,46 +17,116 @@
 
 NordicUARTStream::NordicUARTStream() : NordicUARTService(), Stream()
 {
-    dataConsumed = xSemaphoreCreateBinaryStatic(&dataConsumedBuffer);
+    roomAvailable = xSemaphoreCreateBinaryStatic(&roomAvailableBuffer);
     dataAvailable = xSemaphoreCreateBinaryStatic(&dataAvailableBuffer);
-    xSemaphoreGive(dataConsumed);
+    rxBuffer.setCapacity(NUS_DEFAULT_RX_BUFFER_SIZE);
+    // Note: Print sends one byte at a time
+    enableWriteCoalescing(NUS_DEFAULT_STREAM_FLUSH_DELAY, true);
 }
 
 NordicUARTStream::~NordicUARTStream()
 {
-    vSemaphoreDelete(dataConsumed);
+    vSemaphoreDelete(roomAvailable);
     vSemaphoreDelete(dataAvailable);
 }
 
+void NordicUARTStream::setRxBufferSize(size_t size)
+{
+    if (isConnected())
+        throw std::runtime_error("Unable to set the reception buffer size while connected");
+    if (!rxBuffer.setCapacity(size))
+        throw std::runtime_error("Not enough memory for the reception buffer");
+}
+
 //-----------------------------------------------------------------------------
 // GATT server events
 //-----------------------------------------------------------------------------
 
-void NordicUARTStream::onDisconnect(NimBLEServer *pServer)
+void NordicUARTStream::onConnect(NimBLEServer *pServer)
 {
-    NordicUARTService::onDisconnect(pServer);
+    NordicUARTService::onConnect(pServer);
+    disconnected = false;
+};
 
-    // Awake task at readBytes()
-    disconnected = true;
-    xSemaphoreGive(dataAvailable);
+void NordicUARTStream::onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+{
+    NordicUARTService::onDisconnect(pServer, desc);
+
+    // Awake task at readBytes() when the last peer is gone
+    if (!isConnected())
+    {
+        disconnected = true;
+        xSemaphoreGive(dataAvailable);
+    }
 };
 
 //-----------------------------------------------------------------------------
 // NordicUARTService implementation
 //-----------------------------------------------------------------------------
 
-void NordicUARTStream::onWrite(NimBLECharacteristic *pCharacteristic)
+void NordicUARTStream::onReceive(const uint8_t *data, size_t size)
 {
-    // Wait for previous data to get consumed
-    xSemaphoreTake(dataConsumed, portMAX_DELAY);
-
-    // Hold data until next read
-    incomingPacket = pCharacteristic->getValue();
-    unreadByteCount = incomingPacket.size();
     disconnected = false;
 
+    // Hold data until read
+    size_t count = rxBuffer.write(data, size);
+    data += count;
+    size -= count;
+
+    // Handle buffer overflow
+    if ((size > 0) && (overflowPolicy == RX_OVERFLOW_DROP_OLDEST))
+    {
+        if (size > rxBuffer.capacity())
+        {
+            // Just the most recent bytes fit
+            overflowCount += size - rxBuffer.capacity();
+            data += size - rxBuffer.capacity();
+            size = rxBuffer.capacity();
+        }
+        overflowCount += rxBuffer.discard(size - rxBuffer.freeSpace());
+        rxBuffer.write(data, size);
+        size = 0;
+    }
+    else if ((size > 0) && (overflowPolicy == RX_OVERFLOW_BLOCK))
+    {
+        // Wait for room while there is unread data
+        NUS_STATS(uint64_t blockedSince = NUS_STATS_MICROS());
+        TickType_t start = xTaskGetTickCount();
+        TickType_t elapsed = 0;
+        xSemaphoreGive(dataAvailable);
+        signalEvent(NUS_EVENT_RX_DATA);
+        while ((size > 0) && (elapsed < overflowTimeoutTicks))
+        {
+            writerWaiting = true;
+            // Note: room may be available before writerWaiting was set
+            count = rxBuffer.write(data, size);
+            if (count == 0)
+            {
+                xSemaphoreTake(roomAvailable, overflowTimeoutTicks - elapsed);
+                count = rxBuffer.write(data, size);
+            }
+            data += count;
+            size -= count;
+            elapsed = xTaskGetTickCount() - start;
+        }
+        writerWaiting = false;
+        NUS_STATS(stats.rxBlockedMicros += NUS_STATS_MICROS() - blockedSince);
+    }
+    overflowCount += size;
+    NUS_STATS(recordRxLevel(rxBuffer.available()));
+
     // signal available data
-    xSemaphoreGive(dataAvailable);
+    // Note: at high packet rates, most packets arrive while the reader is busy,
+    // so the semaphore is given only if the reader is waiting for it
+    if (readerWaiting)
+        xSemaphoreGive(dataAvailable);
+    signalEvent(NUS_EVENT_RX_DATA);
+}
+
+void NordicUARTStream::onDataConsumed()
+{
+    if (writerWaiting)
+        xSemaphoreGive(roomAvailable);
 }
 
 //-----------------------------------------------------------------------------
@@ -68,62 +139,86 @@ size_t NordicUARTStream::readBytes(uint8_t *buffer, size_t size)
     while (size > 0)
     {
         // copy previously available data, if any
-        if (unreadByteCount > 0)
+        size_t readBytesCount = rxBuffer.read(buffer, size);
+        if (readBytesCount > 0)
         {
-            const uint8_t *incomingData = incomingPacket.data() + incomingPacket.size() - unreadByteCount;
-            size_t readBytesCount = (unreadByteCount > size) ? size : unreadByteCount;
-            memcpy(buffer, incomingData, readBytesCount);
             buffer = buffer + readBytesCount;
-            unreadByteCount = unreadByteCount - readBytesCount;
             totalReadCount = totalReadCount + readBytesCount;
             size = size - readBytesCount;
-        } // note: at this point (unreadByteCount == 0) || (size == 0)
-        if (unreadByteCount == 0)
-        {
-            xSemaphoreGive(dataConsumed);
+            onDataConsumed();
         }
-        if (size > 0)
+        else if (!waitForData())
+            size = 0; // break;
+    }
+    return totalReadCount;
+}
+
+size_t NordicUARTStream::readBytesUntil(char terminator, uint8_t *buffer, size_t size)
+{
+    size_t totalReadCount = 0;
+    bool found = false;
+    while ((size > 0) && !found)
+    {
+        // copy previously available data up to the terminator, if any
+        size_t readBytesCount = rxBuffer.readUntil((uint8_t)terminator, buffer, size, found);
+        if ((readBytesCount > 0) || found)
         {
-            // wait for more data or timeout or disconnection
-            TickType_t timeoutTicks = (_timeout == ULONG_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(_timeout);
-            if ((xSemaphoreTake(dataAvailable, timeoutTicks) == pdFALSE) || disconnected)
-                size = 0; // break;
-            // Note: at this point, readBuffer and unreadByteCount were updated thanks to onWrite()
+            buffer = buffer + readBytesCount;
+            totalReadCount = totalReadCount + readBytesCount;
+            size = size - readBytesCount;
+            onDataConsumed();
         }
+        else if (!waitForData())
+            size = 0; // break;
     }
     return totalReadCount;
 }
 
+size_t NordicUARTStream::readLine(char *buffer, size_t size)
+{
+    if (size == 0)
+        return 0;
+    size_t length = readBytesUntil('\n', buffer, size - 1);
+    if ((length > 0) && (buffer[length - 1] == '\r'))
+        length--;
+    buffer[length] = '\0';
+    return length;
+}
+
+bool NordicUARTStream::waitForData()
+{
+    if (disconnected)
+        return false;
+    // wait for more data or timeout or disconnection
+    // Note: on return, rxBuffer was updated thanks to onWrite()
+    TickType_t timeoutTicks = (_timeout == ULONG_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(_timeout);
+    readerWaiting = true;
+    // Note: data may be available before readerWaiting was set
+    bool result = (rxBuffer.available() > 0) || (xSemaphoreTake(dataAvailable, timeoutTicks) == pdTRUE);
+    readerWaiting = false;
+    return result;
+}
+
 //-----------------------------------------------------------------------------
 // Stream implementation
 //-----------------------------------------------------------------------------
 
 int NordicUARTStream::available()
 {
-    return unreadByteCount;
+    return rxBuffer.available();
 }
 
 int NordicUARTStream::peek()
 {
-    if (unreadByteCount > 0)
-    {
-        const uint8_t *readBuffer = incomingPacket.data();
-        size_t index = incomingPacket.size() - unreadByteCount;
-        return readBuffer[index];
-    }
-    return -1;
+    return rxBuffer.peek();
 }
 
 int NordicUARTStream::read()
 {
-    if (unreadByteCount > 0)
+    uint8_t result;
+    if (rxBuffer.read(&result, 1))
     {
-        const uint8_t *readBuffer = incomingPacket.data();
-        size_t index = incomingPacket.size() - unreadByteCount;
-        int result = readBuffer[index];
-        unreadByteCount--;
-        if (unreadByteCount == 0)
-            xSemaphoreGive(dataConsumed);
+        onDataConsumed();
         return result;
     }
     return -1;
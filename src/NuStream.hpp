@@ -14,6 +14,26 @@
 #include <climits>
 #include <Stream.h>
 #include "NuS.hpp"
+#include "NuRingBuffer.hpp"
+
+/**
+ * @brief Default size of the reception buffer in bytes
+ *
+ */
+#define NUS_DEFAULT_RX_BUFFER_SIZE 1024
+
+/**
+ * @brief Default timeout (in milliseconds) of the RX_OVERFLOW_BLOCK policy
+ *
+ */
+#define NUS_DEFAULT_RX_OVERFLOW_TIMEOUT 1000
+
+/**
+ * @brief Default maximum time (in milliseconds) that outgoing data is retained
+ *
+ * @note See NordicUARTService::enableWriteCoalescing()
+ */
+#define NUS_DEFAULT_STREAM_FLUSH_DELAY 20
 
 /**
  * @brief Communications stream through BLE and Nordic UART Service
@@ -24,8 +44,9 @@ class NordicUARTStream : public NordicUARTService, public Stream
 public:
     // Overriden Methods
 
-    void onDisconnect(NimBLEServer *pServer) override;
-    void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    void onConnect(NimBLEServer *pServer) override;
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) override;
+    void onReceive(const uint8_t *data, size_t size) override;
 
 public:
     NordicUARTStream();
@@ -77,6 +98,89 @@ public:
         return NordicUARTStream::readBytes((uint8_t *)buffer, length);
     };
 
+    /**
+     * @brief Read characters from a stream into a buffer until a terminator is found
+     *
+     * @note Same as readBytes(), but also terminates when @p terminator is found.
+     *       The terminator is discarded. Buffered data is scanned and copied in bulk,
+     *       instead of byte by byte as `Stream` does.
+     *
+     * @note Not virtual in `Stream`: called through a `Stream` reference,
+     *       the inherited (per byte) implementation is used.
+     *
+     * @param[in] terminator Character where to stop
+     * @param[out] buffer To store the bytes in
+     * @param[in] length Maximum number of bytes to read
+     * @return size_t Number of bytes placed in the buffer, not counting the terminator.
+     */
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length);
+    size_t readBytesUntil(char terminator, char *buffer, size_t length)
+    {
+        return NordicUARTStream::readBytesUntil(terminator, (uint8_t *)buffer, length);
+    };
+
+    /**
+     * @brief Read a line of text
+     *
+     * @note Reads until a line feed, a timeout or peer disconnection.
+     *       The line feed and a preceding carriage return (if any)
+     *       are discarded.
+     *
+     * @param[out] buffer To store a null-terminated string in
+     * @param[in] size Size of @p buffer, including the null terminating character.
+     *                 Longer lines are split.
+     * @return size_t Length of the line placed in the buffer
+     */
+    size_t readLine(char *buffer, size_t size);
+
+public:
+    /**
+     * @brief Set the size of the reception buffer
+     *
+     * @note Incoming data is stored in this buffer until read.
+     *       The BLE stack is never blocked while there is room
+     *       in this buffer. Default size is NUS_DEFAULT_RX_BUFFER_SIZE.
+     *
+     * @note Should be called before start(). Unread data is discarded.
+     *
+     * @param[in] size Size in bytes. Rounded up to a power of two.
+     *
+     * @throws std::runtime_error If called while a peer is connected
+     *                            or not enough memory.
+     */
+    void setRxBufferSize(size_t size);
+
+    /**
+     * @brief Set what to do when the reception buffer is full
+     *
+     * @note Default policy is RX_OVERFLOW_BLOCK for
+     *       NUS_DEFAULT_RX_OVERFLOW_TIMEOUT milliseconds.
+     *
+     * @note RX_OVERFLOW_BLOCK blocks the NimBLE task, unless
+     *       enableRxWorker() is called. Consider a larger buffer
+     *       when writes without response are enabled. See start().
+     *
+     * @param[in] policy Overflow policy
+     * @param[in] timeoutMillis Maximum time to wait for room
+     *                          (in milliseconds) when @p policy is RX_OVERFLOW_BLOCK.
+     *                          Ignored otherwise.
+     */
+    void setRxOverflowPolicy(NuRxOverflowPolicy_t policy, unsigned int timeoutMillis = NUS_DEFAULT_RX_OVERFLOW_TIMEOUT)
+    {
+        overflowTimeoutTicks = pdMS_TO_TICKS(timeoutMillis);
+        overflowPolicy = policy;
+    };
+
+    /**
+     * @brief Get the count of incoming bytes lost due to buffer overflow
+     *
+     * @return size_t Count of bytes lost since start
+     */
+    size_t getRxOverflowCount()
+    {
+        return overflowCount;
+    };
+
 public:
     /**
      * @brief Write a single byte to the stream
@@ -100,15 +204,43 @@ public:
     {
         return NordicUARTService::write(buffer, size);
     };
+    using NordicUARTService::write;
+
+    /**
+     * @brief Get the count of bytes that can be written without waiting
+     *
+     * @return int Count of bytes
+     */
+    virtual int availableForWrite() override
+    {
+        return getTxFreeSpace();
+    };
+
+    /**
+     * @brief Send any pending data retained by write coalescing
+     *
+     */
+    virtual void flush() override
+    {
+        NordicUARTService::flush();
+    };
+    using NordicUARTService::flush;
 
 private:
-    SemaphoreHandle_t dataConsumed;
-    StaticSemaphore_t dataConsumedBuffer;
+    SemaphoreHandle_t roomAvailable;
+    StaticSemaphore_t roomAvailableBuffer;
     SemaphoreHandle_t dataAvailable;
     StaticSemaphore_t dataAvailableBuffer;
-    NimBLEAttValue incomingPacket;
+    NuRingBuffer rxBuffer;
+    NuRxOverflowPolicy_t overflowPolicy = RX_OVERFLOW_BLOCK;
+    TickType_t overflowTimeoutTicks = pdMS_TO_TICKS(NUS_DEFAULT_RX_OVERFLOW_TIMEOUT);
+    size_t overflowCount = 0;
+    std::atomic<bool> writerWaiting{false};
+    std::atomic<bool> readerWaiting{false};
     bool disconnected = false;
-    size_t unreadByteCount = 0;
+
+    void onDataConsumed();
+    bool waitForData();
 };
 
 #endif
\ No newline at end of file